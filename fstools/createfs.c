@@ -0,0 +1,647 @@
+/* createfs.c - Builds a filesystem image (filesys_img) from a directory
+ *
+ * Usage: createfs -i <input directory> -o <output image> [-v 1|2] [-z]
+ *
+ * Version 1 is the original flat layout (boot block, one inode per block,
+ * at most 63 entries with 32 character names). Version 2 (the default) has a
+ * super block, packed 64 byte inodes with indirect blocks, and directories
+ * stored as regular data so subdirectories and 120 character names work.
+ * Both images get a "." entry and an "rtc" device entry in the root.
+ *
+ * -z writes a compressed version 2 image: every data block is LZ4 compressed
+ * on its own (or kept whole if that does not save anything) and the blocks
+ * are packed back to back after a table giving where each one ended up.
+ */
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define BLOCK_SIZE 4096
+
+#define RTC_FILE_TYPE 0
+#define DIRECTORY_FILE_TYPE 1
+#define REGULAR_FILE_TYPE 2
+
+/* Version 1 layout */
+#define V1_NAME_LENGTH 32
+#define V1_MAX_FILES 63
+#define V1_INODES 64
+#define V1_INDEX_NUMBER 1023
+
+/* Version 2 layout (must match student-distrib/file_system.h) */
+#define FS2_MAGIC 0x32463933
+#define FS2_VERSION 2
+#define FS2_NAME_LENGTH 120
+#define FS2_DENTRY_SIZE 128
+#define FS2_INODE_SIZE 64
+#define FS2_INODES_PER_BLOCK (BLOCK_SIZE / FS2_INODE_SIZE)
+#define FS2_DIRECT_BLOCKS 12
+#define FS2_POINTERS_PER_BLOCK (BLOCK_SIZE / 4)
+#define FS2_FLAG_COMPRESSED 0x1
+#define FS2_BLOCK_COMPRESSED 0x80000000
+#define FS2_BLOCK_ENTRY_SIZE 8
+#define FS2_ENTRIES_PER_TABLE_BLOCK (BLOCK_SIZE / FS2_BLOCK_ENTRY_SIZE)
+
+/* LZ4 block format (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md) */
+#define LZ4_HASH_BITS 12
+#define LZ4_MIN_MATCH 4
+#define LZ4_MF_LIMIT 12     /* the last match starts at least this far from the end */
+#define LZ4_LAST_LITERALS 5 /* and the last bytes are always literals */
+#define LZ4_MAX_OFFSET 65535
+#define LZ4_RUN_MASK 15
+
+#define MAX_PATH 4096
+
+typedef struct node
+{
+    char name[FS2_NAME_LENGTH + 1];
+    char path[MAX_PATH];
+    uint32_t type;
+    uint32_t inode;
+    uint32_t length;
+    uint8_t *data;
+    struct node *parent;
+    struct node **children;
+    uint32_t num_children;
+} node_t;
+
+typedef struct image
+{
+    uint8_t *blocks;
+    uint32_t num_blocks;
+    uint32_t next_block;
+    uint32_t data_start; /* first data block (after the inodes and any block table) */
+} image_t;
+
+static node_t **all_nodes;
+static uint32_t num_nodes;
+
+/* die
+ *  Input: message
+ *  Output: none (exits)
+ *  Description: Prints an error and stops
+ */
+static void die(const char *message, const char *detail)
+{
+    fprintf(stderr, "createfs: %s%s%s\n", message, detail ? ": " : "", detail ? detail : "");
+    exit(1);
+}
+
+/* xcalloc
+ *  Input: count, size
+ *  Output: zeroed memory (never NULL)
+ */
+static void *xcalloc(size_t count, size_t size)
+{
+    void *ptr = calloc(count ? count : 1, size ? size : 1);
+    if (ptr == NULL)
+        die("out of memory", NULL);
+    return ptr;
+}
+
+/* read_whole_file
+ *  Input: path, length (output)
+ *  Output: buffer holding the file
+ */
+static uint8_t *read_whole_file(const char *path, uint32_t *length)
+{
+    FILE *fp = fopen(path, "rb");
+    struct stat st;
+    uint8_t *data;
+
+    if (fp == NULL || stat(path, &st) != 0)
+        die("cannot read", path);
+    data = xcalloc(st.st_size, 1);
+    if (st.st_size != 0 && fread(data, 1, st.st_size, fp) != (size_t)st.st_size)
+        die("short read", path);
+    fclose(fp);
+    *length = st.st_size;
+    return data;
+}
+
+/* compare_nodes
+ *  Description: qsort helper that orders directory entries by name
+ */
+static int compare_nodes(const void *a, const void *b)
+{
+    return strcmp((*(node_t **)a)->name, (*(node_t **)b)->name);
+}
+
+/* scan_directory
+ *  Input: path, name, parent
+ *  Output: tree of nodes for everything under path (hidden files are skipped)
+ */
+static node_t *scan_directory(const char *path, const char *name, node_t *parent)
+{
+    node_t *dir = xcalloc(1, sizeof(node_t));
+    DIR *dp = opendir(path);
+    struct dirent *de;
+    uint32_t capacity = 0;
+
+    if (dp == NULL)
+        die("cannot open directory", path);
+    snprintf(dir->name, sizeof(dir->name), "%s", name);
+    snprintf(dir->path, sizeof(dir->path), "%s", path);
+    dir->type = DIRECTORY_FILE_TYPE;
+    dir->parent = parent ? parent : dir;
+
+    while ((de = readdir(dp)) != NULL)
+    {
+        char child_path[MAX_PATH];
+        struct stat st;
+        node_t *child;
+
+        if (de->d_name[0] == '.')
+            continue;
+        if (strlen(de->d_name) > FS2_NAME_LENGTH)
+            die("name too long", de->d_name);
+        snprintf(child_path, sizeof(child_path), "%s/%s", path, de->d_name);
+        if (stat(child_path, &st) != 0)
+            die("cannot stat", child_path);
+
+        if (S_ISDIR(st.st_mode))
+        {
+            child = scan_directory(child_path, de->d_name, dir);
+        }
+        else if (S_ISREG(st.st_mode))
+        {
+            child = xcalloc(1, sizeof(node_t));
+            snprintf(child->name, sizeof(child->name), "%s", de->d_name);
+            snprintf(child->path, sizeof(child->path), "%s", child_path);
+            child->type = REGULAR_FILE_TYPE;
+            child->parent = dir;
+        }
+        else
+        {
+            continue;
+        }
+
+        if (dir->num_children == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 16;
+            dir->children = realloc(dir->children, capacity * sizeof(node_t *));
+            if (dir->children == NULL)
+                die("out of memory", NULL);
+        }
+        dir->children[dir->num_children++] = child;
+    }
+    closedir(dp);
+    qsort(dir->children, dir->num_children, sizeof(node_t *), compare_nodes);
+    return dir;
+}
+
+/* number_nodes
+ *  Input: root of the tree
+ *  Output: none
+ *  Description: Gives every node an inode number in pre-order (root is inode 0)
+ */
+static void number_nodes(node_t *node)
+{
+    uint32_t i;
+    node->inode = num_nodes;
+    all_nodes = realloc(all_nodes, (num_nodes + 1) * sizeof(node_t *));
+    if (all_nodes == NULL)
+        die("out of memory", NULL);
+    all_nodes[num_nodes++] = node;
+    for (i = 0; i < node->num_children; i++)
+        number_nodes(node->children[i]);
+}
+
+/* put_dentry
+ *  Input: buffer, name, type, inode
+ *  Output: none
+ *  Description: Writes one 128 byte version 2 directory entry
+ */
+static void put_dentry(uint8_t *entry, const char *name, uint32_t type, uint32_t inode)
+{
+    memcpy(entry, &inode, 4);
+    memcpy(entry + 4, &type, 4);
+    memcpy(entry + 8, name, strlen(name));
+}
+
+/* build_directory_data
+ *  Input: directory node
+ *  Output: none
+ *  Description: Lays out ".", "..", "rtc" (root only) and the children as the directory contents
+ */
+static void build_directory_data(node_t *dir, int is_root)
+{
+    uint32_t num_entries = 2 + (is_root ? 1 : 0) + dir->num_children;
+    uint32_t i, e = 0;
+
+    dir->length = num_entries * FS2_DENTRY_SIZE;
+    dir->data = xcalloc(dir->length, 1);
+    put_dentry(dir->data + FS2_DENTRY_SIZE * e++, ".", DIRECTORY_FILE_TYPE, dir->inode);
+    put_dentry(dir->data + FS2_DENTRY_SIZE * e++, "..", DIRECTORY_FILE_TYPE, dir->parent->inode);
+    if (is_root)
+        put_dentry(dir->data + FS2_DENTRY_SIZE * e++, "rtc", RTC_FILE_TYPE, 0);
+    for (i = 0; i < dir->num_children; i++)
+        put_dentry(dir->data + FS2_DENTRY_SIZE * e++, dir->children[i]->name, dir->children[i]->type, dir->children[i]->inode);
+}
+
+/* blocks_for_length
+ *  Input: length in bytes
+ *  Output: number of data blocks plus the indirect blocks needed to address them
+ */
+static uint32_t blocks_for_length(uint32_t length)
+{
+    uint32_t data = (length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    uint32_t total = data;
+
+    if (data > FS2_DIRECT_BLOCKS)
+        total++;
+    if (data > FS2_DIRECT_BLOCKS + FS2_POINTERS_PER_BLOCK)
+        total += 1 + (data - FS2_DIRECT_BLOCKS - FS2_POINTERS_PER_BLOCK + FS2_POINTERS_PER_BLOCK - 1) / FS2_POINTERS_PER_BLOCK;
+    return total;
+}
+
+/* alloc_block
+ *  Input: image
+ *  Output: absolute number of the next free block
+ */
+static uint32_t alloc_block(image_t *img)
+{
+    if (img->next_block >= img->num_blocks)
+        die("internal error: ran out of blocks", NULL);
+    return img->next_block++;
+}
+
+/* block_ptr
+ *  Input: image, block number
+ *  Output: pointer to the block
+ */
+static uint8_t *block_ptr(image_t *img, uint32_t block)
+{
+    return img->blocks + (size_t)block * BLOCK_SIZE;
+}
+
+/* write_fs2_file
+ *  Input: image, inode struct location, node
+ *  Output: none
+ *  Description: Copies the contents of a node into data blocks and fills in its block pointers
+ */
+static void write_fs2_file(image_t *img, uint8_t *inode_ptr, node_t *node)
+{
+    uint32_t num_data = (node->length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    uint32_t *fields = (uint32_t *)inode_ptr;
+    uint32_t *indirect = NULL;
+    uint32_t *double_indirect = NULL;
+    uint32_t *table = NULL;
+    uint32_t i;
+
+    fields[0] = node->length;
+    fields[1] = node->type;
+    for (i = 0; i < num_data; i++)
+    {
+        uint32_t block = alloc_block(img);
+        uint32_t chunk = node->length - i * BLOCK_SIZE;
+        if (chunk > BLOCK_SIZE)
+            chunk = BLOCK_SIZE;
+        memcpy(block_ptr(img, block), node->data + i * BLOCK_SIZE, chunk);
+
+        if (i < FS2_DIRECT_BLOCKS)
+        {
+            fields[2 + i] = block;
+        }
+        else if (i < FS2_DIRECT_BLOCKS + FS2_POINTERS_PER_BLOCK)
+        {
+            if (indirect == NULL)
+            {
+                fields[2 + FS2_DIRECT_BLOCKS] = alloc_block(img);
+                indirect = (uint32_t *)block_ptr(img, fields[2 + FS2_DIRECT_BLOCKS]);
+            }
+            indirect[i - FS2_DIRECT_BLOCKS] = block;
+        }
+        else
+        {
+            uint32_t index = i - FS2_DIRECT_BLOCKS - FS2_POINTERS_PER_BLOCK;
+            if (double_indirect == NULL)
+            {
+                fields[3 + FS2_DIRECT_BLOCKS] = alloc_block(img);
+                double_indirect = (uint32_t *)block_ptr(img, fields[3 + FS2_DIRECT_BLOCKS]);
+            }
+            if (index % FS2_POINTERS_PER_BLOCK == 0)
+            {
+                double_indirect[index / FS2_POINTERS_PER_BLOCK] = alloc_block(img);
+                table = (uint32_t *)block_ptr(img, double_indirect[index / FS2_POINTERS_PER_BLOCK]);
+            }
+            table[index % FS2_POINTERS_PER_BLOCK] = block;
+        }
+    }
+}
+
+/* lz4_put_length
+ *  Input: output position, length beyond the 15 held in the token
+ *  Output: position after the length bytes
+ */
+static uint8_t *lz4_put_length(uint8_t *op, uint32_t length)
+{
+    while (length >= 255)
+    {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = length;
+    return op;
+}
+
+/* lz4_put_sequence
+ *  Input: output position and end, literals, match offset and length (0 for the last sequence)
+ *  Output: position after the sequence, NULL if it does not fit
+ */
+static uint8_t *lz4_put_sequence(uint8_t *op, uint8_t *op_end, const uint8_t *literals, uint32_t num_literals,
+                                 uint32_t offset, uint32_t match_length)
+{
+    uint8_t *token = op++;
+
+    /* Worst case: token, literal length bytes, literals, offset, match length bytes */
+    if (op_end - token < (long)(1 + num_literals / 255 + 1 + num_literals + 2 + match_length / 255 + 1))
+        return NULL;
+    *token = (num_literals >= LZ4_RUN_MASK ? LZ4_RUN_MASK : num_literals) << 4;
+    if (num_literals >= LZ4_RUN_MASK)
+        op = lz4_put_length(op, num_literals - LZ4_RUN_MASK);
+    memcpy(op, literals, num_literals);
+    op += num_literals;
+    if (match_length == 0)
+        return op;
+    *op++ = offset & 0xFF;
+    *op++ = offset >> 8;
+    match_length -= LZ4_MIN_MATCH;
+    if (match_length >= LZ4_RUN_MASK)
+    {
+        *token |= LZ4_RUN_MASK;
+        op = lz4_put_length(op, match_length - LZ4_RUN_MASK);
+    }
+    else
+    {
+        *token |= match_length;
+    }
+    return op;
+}
+
+/* lz4_compress
+ *  Input: data, its length, output buffer and its size
+ *  Output: compressed length, 0 if it does not fit in the output buffer
+ *  Description: Greedy LZ4 block compressor: each position is matched against
+ *               the last position with the same 4 byte hash
+ */
+static uint32_t lz4_compress(const uint8_t *src, uint32_t length, uint8_t *dst, uint32_t capacity)
+{
+    int32_t table[1 << LZ4_HASH_BITS];
+    uint32_t ip = 0, anchor = 0;
+    uint8_t *op = dst;
+    uint8_t *op_end = dst + capacity;
+
+    memset(table, -1, sizeof(table));
+    while (ip + LZ4_MF_LIMIT <= length)
+    {
+        uint32_t sequence, ref_sequence, hash, match_end;
+        int32_t ref;
+
+        memcpy(&sequence, src + ip, 4);
+        hash = (sequence * 2654435761U) >> (32 - LZ4_HASH_BITS);
+        ref = table[hash];
+        table[hash] = ip;
+        if (ref >= 0)
+            memcpy(&ref_sequence, src + ref, 4);
+        if (ref < 0 || ip - ref > LZ4_MAX_OFFSET || ref_sequence != sequence)
+        {
+            ip++;
+            continue;
+        }
+        match_end = ip + LZ4_MIN_MATCH;
+        while (match_end < length - LZ4_LAST_LITERALS && src[match_end] == src[ref + match_end - ip])
+            match_end++;
+        op = lz4_put_sequence(op, op_end, src + anchor, ip - anchor, ip - ref, match_end - ip);
+        if (op == NULL)
+            return 0;
+        ip = match_end;
+        anchor = ip;
+    }
+    op = lz4_put_sequence(op, op_end, src + anchor, length - anchor, 0, 0);
+    return op == NULL ? 0 : op - dst;
+}
+
+/* pack_v2
+ *  Input: built version 2 image with room for the block table, image (output)
+ *  Output: none
+ *  Description: Compresses every data block and packs them after the block table
+ */
+static void pack_v2(image_t *img)
+{
+    uint32_t num_data = img->num_blocks - img->data_start;
+    uint8_t *packed = xcalloc(img->num_blocks + 1, BLOCK_SIZE);
+    uint8_t compressed[BLOCK_SIZE];
+    uint32_t *super = (uint32_t *)block_ptr(img, 0);
+    uint32_t *table = (uint32_t *)block_ptr(img, 1 + super[3]);
+    size_t used = (size_t)img->data_start * BLOCK_SIZE;
+    uint32_t i, num_compressed = 0;
+
+    for (i = 0; i < num_data; i++)
+    {
+        uint8_t *block = block_ptr(img, img->data_start + i);
+        /* Only worth it if it saves at least a byte */
+        uint32_t size = lz4_compress(block, BLOCK_SIZE, compressed, BLOCK_SIZE - 1);
+
+        table[2 * i] = used;
+        if (size != 0)
+        {
+            memcpy(packed + used, compressed, size);
+            table[2 * i + 1] = size | FS2_BLOCK_COMPRESSED;
+            num_compressed++;
+        }
+        else
+        {
+            size = BLOCK_SIZE;
+            memcpy(packed + used, block, size);
+            table[2 * i + 1] = size;
+        }
+        used += size;
+    }
+    super[6] = FS2_FLAG_COMPRESSED;
+    super[8] = (used + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    /* Super block, inodes and table are stored as they are */
+    memcpy(packed, img->blocks, (size_t)img->data_start * BLOCK_SIZE);
+    printf("createfs: compressed %u of %u data blocks, %u kB -> %u kB\n", num_compressed, num_data,
+           num_data * BLOCK_SIZE / 1024, (uint32_t)((used - (size_t)img->data_start * BLOCK_SIZE + 1023) / 1024));
+
+    img->num_blocks = super[8];
+    free(img->blocks);
+    img->blocks = packed;
+}
+
+/* build_v2
+ *  Input: root of the tree, image (output), whether to compress it
+ *  Output: none
+ */
+static void build_v2(node_t *root, image_t *img, int compress)
+{
+    uint32_t inode_blocks, data_blocks = 0, table_blocks = 0;
+    uint32_t i;
+    uint32_t *super;
+
+    number_nodes(root);
+    for (i = 0; i < num_nodes; i++)
+    {
+        if (all_nodes[i]->type == DIRECTORY_FILE_TYPE)
+            build_directory_data(all_nodes[i], all_nodes[i] == root);
+        else
+            all_nodes[i]->data = read_whole_file(all_nodes[i]->path, &all_nodes[i]->length);
+        data_blocks += blocks_for_length(all_nodes[i]->length);
+    }
+    inode_blocks = (num_nodes + FS2_INODES_PER_BLOCK - 1) / FS2_INODES_PER_BLOCK;
+    /* Block numbers in a compressed image count as if the table were followed by whole blocks */
+    if (compress)
+        table_blocks = (data_blocks + FS2_ENTRIES_PER_TABLE_BLOCK - 1) / FS2_ENTRIES_PER_TABLE_BLOCK;
+
+    img->num_blocks = 1 + inode_blocks + table_blocks + data_blocks;
+    img->blocks = xcalloc(img->num_blocks, BLOCK_SIZE);
+    img->data_start = 1 + inode_blocks + table_blocks;
+    img->next_block = img->data_start;
+
+    super = (uint32_t *)block_ptr(img, 0);
+    super[0] = FS2_MAGIC;
+    super[1] = FS2_VERSION;
+    super[2] = num_nodes;
+    super[3] = inode_blocks;
+    super[4] = data_blocks;
+    super[5] = root->inode;
+    super[6] = 0;
+    super[7] = table_blocks;
+
+    for (i = 0; i < num_nodes; i++)
+        write_fs2_file(img, block_ptr(img, 1) + i * FS2_INODE_SIZE, all_nodes[i]);
+    if (compress)
+        pack_v2(img);
+}
+
+/* put_v1_dentry
+ *  Input: image, entry index, name, type, inode
+ *  Output: none
+ *  Description: Writes one 64 byte version 1 entry into the boot block (names are not terminated at 32 chars)
+ */
+static void put_v1_dentry(image_t *img, uint32_t index, const char *name, uint32_t type, uint32_t inode)
+{
+    uint8_t *entry = block_ptr(img, 0) + 64 * (index + 1);
+    uint32_t length = strlen(name);
+
+    /* Longer names are cut to 32 characters like the original tool did */
+    memcpy(entry, name, length > V1_NAME_LENGTH ? V1_NAME_LENGTH : length);
+    memcpy(entry + V1_NAME_LENGTH, &type, 4);
+    memcpy(entry + V1_NAME_LENGTH + 4, &inode, 4);
+}
+
+/* build_v1
+ *  Input: root of the tree, image (output)
+ *  Output: none
+ *  Description: Original flat layout; only regular files in the top directory are allowed
+ */
+static void build_v1(node_t *root, image_t *img)
+{
+    uint32_t data_blocks = 0;
+    uint32_t i, j, entry = 0;
+    uint32_t *boot;
+
+    if (root->num_children + 2 > V1_MAX_FILES)
+        die("too many files for a version 1 image (use -v 2)", NULL);
+    for (i = 0; i < root->num_children; i++)
+    {
+        node_t *file = root->children[i];
+        if (file->type != REGULAR_FILE_TYPE)
+            die("version 1 images cannot hold subdirectories", file->name);
+        file->data = read_whole_file(file->path, &file->length);
+        if ((file->length + BLOCK_SIZE - 1) / BLOCK_SIZE > V1_INDEX_NUMBER)
+            die("file too large for a version 1 image", file->name);
+        data_blocks += (file->length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    }
+
+    img->num_blocks = 1 + V1_INODES + data_blocks;
+    img->blocks = xcalloc(img->num_blocks, BLOCK_SIZE);
+
+    boot = (uint32_t *)block_ptr(img, 0);
+    boot[0] = root->num_children + 2;
+    boot[1] = V1_INODES;
+    boot[2] = data_blocks;
+
+    /* Entries start 64 bytes in: name[32], type, inode, reserved[24] */
+    put_v1_dentry(img, entry++, ".", DIRECTORY_FILE_TYPE, 0);
+    put_v1_dentry(img, entry++, "rtc", RTC_FILE_TYPE, 0);
+
+    data_blocks = 0;
+    for (i = 0; i < root->num_children; i++)
+    {
+        node_t *file = root->children[i];
+        uint32_t *inode = (uint32_t *)block_ptr(img, 1 + i);
+
+        put_v1_dentry(img, entry++, file->name, REGULAR_FILE_TYPE, i);
+
+        inode[0] = file->length;
+        for (j = 0; j * BLOCK_SIZE < file->length; j++)
+        {
+            uint32_t chunk = file->length - j * BLOCK_SIZE;
+            if (chunk > BLOCK_SIZE)
+                chunk = BLOCK_SIZE;
+            inode[1 + j] = data_blocks;
+            memcpy(block_ptr(img, 1 + V1_INODES + data_blocks), file->data + j * BLOCK_SIZE, chunk);
+            data_blocks++;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *input = NULL;
+    const char *output = NULL;
+    int version = 2;
+    int compress = 0;
+    image_t img;
+    node_t *root;
+    FILE *fp;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:o:v:z")) != -1)
+    {
+        switch (opt)
+        {
+        case 'i':
+            input = optarg;
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        case 'v':
+            version = atoi(optarg);
+            break;
+        case 'z':
+            compress = 1;
+            break;
+        default:
+            input = NULL;
+            break;
+        }
+    }
+    if (input == NULL || output == NULL || (version != 1 && version != 2) || (compress && version != 2))
+    {
+        fprintf(stderr, "usage: %s -i <input directory> -o <output image> [-v 1|2] [-z]\n", argv[0]);
+        return 1;
+    }
+
+    memset(&img, 0, sizeof(img));
+    root = scan_directory(input, ".", NULL);
+    if (version == 1)
+        build_v1(root, &img);
+    else
+        build_v2(root, &img, compress);
+
+    fp = fopen(output, "wb");
+    if (fp == NULL || fwrite(img.blocks, BLOCK_SIZE, img.num_blocks, fp) != img.num_blocks)
+        die("cannot write", output);
+    fclose(fp);
+    printf("createfs: wrote version %d image %s (%u blocks)\n", version, output, img.num_blocks);
+    return 0;
+}
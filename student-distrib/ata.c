@@ -0,0 +1,541 @@
+#include "ata.h"
+#include "lib.h"
+#include "i8259.h"
+#include "pci.h"
+
+// Referenced https://wiki.osdev.org/ATA_PIO_Mode and https://wiki.osdev.org/ATA/ATAPI_using_DMA
+
+#define EFLAGS_IF 0x200		   // Interrupt flag in EFLAGS
+#define ATA_FLOATING_BUS 0xFF  // Status read back when there is no controller
+#define ATA_IRQ_TIMEOUT 500	   // Wake ups (PIT ticks at most) to wait for a running request
+
+// Size of the filesystem disk in sectors (0 when there is no disk)
+static uint32_t ata_sectors;
+
+// Bus master I/O base from BAR4, 0 when transfers fall back to PIO
+static uint32_t ata_bm_base;
+
+// Regions of the DMA transfer in flight; aligned to its size so it never crosses 64KB
+static ata_prd_t ata_prdt[ATA_PRD_ENTRIES] __attribute__((aligned(ATA_PRD_ENTRIES * sizeof(ata_prd_t))));
+
+// Requests waiting for the drive, sorted by LBA
+static ata_request_t *ata_queue;
+
+// Chain of merged requests the drive is working on (NULL when idle)
+static ata_request_t *ata_active;
+
+// Sector right after the last command; the elevator sweeps up from here
+static uint32_t ata_head;
+
+// Nonzero while a batch is being queued
+static uint32_t ata_plugged;
+
+// PIO: request and spot in its buffer that the next sector goes to
+static ata_request_t *ata_pio_request;
+static uint16_t *ata_pio_buf;
+static uint32_t ata_pio_left;
+
+/**
+ * @brief Gives the drive the 400ns it needs after being selected
+ *        (each alternate status read takes about 100ns)
+ */
+static void ata_select_delay(void)
+{
+    int i;
+    for (i = 0; i < ATA_SELECT_DELAY; i++)
+    {
+        inb(ATA_ALT_STATUS_PORT);
+    }
+}
+
+/**
+ * @brief Waits for the drive to stop being busy
+ *
+ * @return Status register once not busy, -1 if the drive failed or timed out
+ */
+static int32_t ata_wait_ready(void)
+{
+    uint32_t i, status;
+    for (i = 0; i < ATA_TIMEOUT; i++)
+    {
+        status = inb(ATA_ALT_STATUS_PORT);
+        if (!(status & ATA_STATUS_BSY))
+        {
+            if (status & (ATA_STATUS_ERR | ATA_STATUS_DF))
+            {
+                return -1;
+            }
+            return status;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Finds the bus master registers of the IDE controller and lets it do DMA
+ *        (Leaves ata_bm_base at 0 if there is no PCI IDE controller)
+ */
+static void ata_dma_init(void)
+{
+    uint32_t location, bar;
+    ata_bm_base = 0;
+    location = pci_find_class(ATA_PCI_CLASS, ATA_PCI_SUBCLASS);
+    if (location == PCI_NONE)
+    {
+        return;
+    }
+    bar = pci_config_read(location, PCI_BAR4_OFFSET);
+    if (!(bar & PCI_BAR_IO) || (bar & PCI_BAR_IO_MASK) == 0)
+    {
+        return;
+    }
+    ata_bm_base = bar & PCI_BAR_IO_MASK;
+    pci_config_write(location, PCI_COMMAND_OFFSET,
+                     pci_config_read(location, PCI_COMMAND_OFFSET) | PCI_COMMAND_IO | PCI_COMMAND_BUS_MASTER);
+}
+
+/**
+ * @brief Looks for the filesystem disk and turns on IRQ14
+ *        Probes with IDENTIFY while the drive's interrupt is masked
+ *
+ * @return 0 if an ATA disk was found, -1 otherwise
+ */
+int32_t ata_init(void)
+{
+    uint16_t identify[ATA_SECTOR_WORDS];
+    int32_t status;
+
+    ata_sectors = 0;
+    // Nothing answers on a floating bus
+    if (inb(ATA_STATUS_PORT) == ATA_FLOATING_BUS)
+    {
+        return -1;
+    }
+    // Poll while probing
+    outb(ATA_CONTROL_NIEN, ATA_CONTROL_PORT);
+    outb(ATA_DRIVE_LBA | ATA_FS_DRIVE, ATA_DRIVE_PORT);
+    ata_select_delay();
+    outb(0, ATA_SECTOR_COUNT_PORT);
+    outb(0, ATA_LBA_LOW_PORT);
+    outb(0, ATA_LBA_MID_PORT);
+    outb(0, ATA_LBA_HIGH_PORT);
+    outb(ATA_CMD_IDENTIFY, ATA_COMMAND_PORT);
+    // A status of 0 means the drive does not exist
+    if (inb(ATA_STATUS_PORT) == 0)
+    {
+        return -1;
+    }
+    status = ata_wait_ready();
+    // ATAPI and SATA devices leave a signature in the LBA registers instead of answering
+    if (status == -1 || inb(ATA_LBA_MID_PORT) != 0 || inb(ATA_LBA_HIGH_PORT) != 0)
+    {
+        return -1;
+    }
+    if (!(status & ATA_STATUS_DRQ))
+    {
+        return -1;
+    }
+    insw(ATA_DATA_PORT, identify, ATA_SECTOR_WORDS);
+    ata_sectors = identify[ATA_IDENTIFY_LBA28_SECTORS] | (identify[ATA_IDENTIFY_LBA28_SECTORS + 1] << 16);
+
+    ata_dma_init();
+
+    // Let the drive interrupt again
+    inb(ATA_STATUS_PORT);
+    outb(0, ATA_CONTROL_PORT);
+    enable_irq(ATA_IRQ);
+    return 0;
+}
+
+/**
+ * @brief Number of sectors on the filesystem disk
+ *
+ * @return Sector count, 0 if there is no disk
+ */
+uint32_t ata_sector_count(void)
+{
+    return ata_sectors;
+}
+
+/**
+ * @brief Counts the regions a buffer needs in the PRD table
+ *
+ * @param buf Start of the buffer
+ * @param bytes Length of the buffer
+ * @return Number of 64KB-bounded regions the buffer covers
+ */
+static uint32_t ata_prd_needed(void *buf, uint32_t bytes)
+{
+    uint32_t start = (uint32_t)buf;
+    return ((start + bytes - 1) >> 16) - (start >> 16) + 1;
+}
+
+/**
+ * @brief Adds a buffer to the PRD table, split at 64KB boundaries
+ *
+ * @param entry First free entry of the table
+ * @param buf Start of the buffer (physical == virtual in kernel memory)
+ * @param bytes Length of the buffer
+ * @return Next free entry of the table
+ */
+static uint32_t ata_add_prds(uint32_t entry, void *buf, uint32_t bytes)
+{
+    uint32_t address = (uint32_t)buf;
+    uint32_t chunk;
+    while (bytes > 0)
+    {
+        chunk = ATA_PRD_MAX_BYTES - (address & (ATA_PRD_MAX_BYTES - 1));
+        if (chunk > bytes)
+        {
+            chunk = bytes;
+        }
+        ata_prdt[entry].address = address;
+        ata_prdt[entry].byte_count = chunk & (ATA_PRD_MAX_BYTES - 1);
+        ata_prdt[entry].flags = 0;
+        entry++;
+        address += chunk;
+        bytes -= chunk;
+    }
+    return entry;
+}
+
+/**
+ * @brief Sends one read command covering a chain of adjacent requests
+ *        (interrupts must be off)
+ *
+ * @param chain First request; the rest follow through next
+ * @param total Sectors in the whole chain
+ */
+static void ata_issue(ata_request_t *chain, uint32_t total)
+{
+    ata_request_t *req;
+    uint32_t entry = 0;
+    uint32_t lba = chain->lba;
+
+    outb(ATA_DRIVE_LBA | ATA_FS_DRIVE | ((lba >> 24) & 0x0F), ATA_DRIVE_PORT);
+    ata_select_delay();
+    if (ata_bm_base != 0)
+    {
+        // One region list for the whole chain, so the drive fills every buffer in one go
+        for (req = chain; req != NULL; req = req->next)
+        {
+            entry = ata_add_prds(entry, req->buf, req->count * ATA_SECTOR_SIZE);
+        }
+        ata_prdt[entry - 1].flags = ATA_PRD_END;
+        outb(0, ata_bm_base + ATA_BM_COMMAND);
+        outb(ATA_BM_STATUS_ERROR | ATA_BM_STATUS_IRQ, ata_bm_base + ATA_BM_STATUS);
+        outl((uint32_t)ata_prdt, ata_bm_base + ATA_BM_PRDT);
+    }
+    else
+    {
+        ata_pio_request = chain;
+        ata_pio_buf = (uint16_t *)chain->buf;
+        ata_pio_left = chain->count;
+    }
+    // A count of 0 asks for 256 sectors
+    outb(total & 0xFF, ATA_SECTOR_COUNT_PORT);
+    outb(lba & 0xFF, ATA_LBA_LOW_PORT);
+    outb((lba >> 8) & 0xFF, ATA_LBA_MID_PORT);
+    outb((lba >> 16) & 0xFF, ATA_LBA_HIGH_PORT);
+    if (ata_bm_base != 0)
+    {
+        outb(ATA_CMD_READ_DMA, ATA_COMMAND_PORT);
+        outb(ATA_BM_START | ATA_BM_READ, ata_bm_base + ATA_BM_COMMAND);
+    }
+    else
+    {
+        outb(ATA_CMD_READ_SECTORS, ATA_COMMAND_PORT);
+    }
+}
+
+/**
+ * @brief Starts the next command if the drive is idle (interrupts must be off)
+ *        Picks requests elevator style (one sweep up the disk, then back to the lowest LBA)
+ *        and merges the ones that continue where the picked one ends
+ */
+static void ata_start(void)
+{
+    ata_request_t *prev, *pick, *tail, *req;
+    uint32_t total, regions;
+
+    if (ata_active != NULL || ata_queue == NULL || ata_plugged)
+    {
+        return;
+    }
+    // First request at or past the head, wrapping to the lowest LBA
+    prev = NULL;
+    pick = ata_queue;
+    while (pick != NULL && pick->lba < ata_head)
+    {
+        prev = pick;
+        pick = pick->next;
+    }
+    if (pick == NULL)
+    {
+        prev = NULL;
+        pick = ata_queue;
+    }
+
+    // The queue is sorted, so requests that continue the chain come right after it
+    tail = pick;
+    total = pick->count;
+    regions = ata_prd_needed(pick->buf, pick->count * ATA_SECTOR_SIZE);
+    while (tail->next != NULL && tail->next->lba == tail->lba + tail->count &&
+           total + tail->next->count <= ATA_MAX_SECTORS &&
+           regions + ata_prd_needed(tail->next->buf, tail->next->count * ATA_SECTOR_SIZE) <= ATA_PRD_ENTRIES)
+    {
+        tail = tail->next;
+        total += tail->count;
+        regions += ata_prd_needed(tail->buf, tail->count * ATA_SECTOR_SIZE);
+    }
+
+    // Take the chain out of the queue
+    if (prev == NULL)
+    {
+        ata_queue = tail->next;
+    }
+    else
+    {
+        prev->next = tail->next;
+    }
+    tail->next = NULL;
+    for (req = pick; req != NULL; req = req->next)
+    {
+        req->state = ATA_REQUEST_RUNNING;
+    }
+    ata_active = pick;
+    ata_head = pick->lba + total;
+    ata_issue(pick, total);
+}
+
+/**
+ * @brief Ends the command in flight and starts the next one (interrupts must be off)
+ *
+ * @param state ATA_REQUEST_DONE or ATA_REQUEST_FAILED for every request of the chain
+ */
+static void ata_finish(uint32_t state)
+{
+    ata_request_t *req = ata_active;
+    ata_request_t *next;
+    ata_active = NULL;
+    while (req != NULL)
+    {
+        // The waiter may reuse the request as soon as its state changes
+        next = req->next;
+        req->next = NULL;
+        req->state = state;
+        req = next;
+    }
+    ata_start();
+}
+
+/**
+ * @brief Gives up on the command in flight and resets the drive (interrupts must be off)
+ */
+static void ata_abort(void)
+{
+    if (ata_bm_base != 0)
+    {
+        outb(0, ata_bm_base + ATA_BM_COMMAND);
+    }
+    outb(ATA_CONTROL_SRST, ATA_CONTROL_PORT);
+    ata_select_delay();
+    outb(0, ATA_CONTROL_PORT);
+    ata_wait_ready();
+    ata_finish(ATA_REQUEST_FAILED);
+}
+
+/**
+ * @brief Moves the command in flight along (interrupts must be off)
+ *        DMA: completes the chain once the controller has seen the interrupt;
+ *        PIO: copies the sector the drive has ready into the right request
+ *
+ * @note  Reading the status register acknowledges the drive
+ */
+static void ata_service(void)
+{
+    uint32_t status, bm_status;
+
+    if (ata_active == NULL)
+    {
+        inb(ATA_STATUS_PORT);
+        return;
+    }
+    if (ata_bm_base != 0)
+    {
+        bm_status = inb(ata_bm_base + ATA_BM_STATUS);
+        if (!(bm_status & ATA_BM_STATUS_IRQ))
+        {
+            return;
+        }
+        outb(0, ata_bm_base + ATA_BM_COMMAND);
+        status = inb(ATA_STATUS_PORT);
+        // Interrupt and error bits are cleared by writing them back
+        outb(bm_status, ata_bm_base + ATA_BM_STATUS);
+        if ((bm_status & ATA_BM_STATUS_ERROR) || (status & (ATA_STATUS_ERR | ATA_STATUS_DF)))
+        {
+            ata_finish(ATA_REQUEST_FAILED);
+        }
+        else
+        {
+            ata_finish(ATA_REQUEST_DONE);
+        }
+        return;
+    }
+
+    if (inb(ATA_ALT_STATUS_PORT) & ATA_STATUS_BSY)
+    {
+        return;
+    }
+    status = inb(ATA_STATUS_PORT);
+    if (status & (ATA_STATUS_ERR | ATA_STATUS_DF))
+    {
+        ata_finish(ATA_REQUEST_FAILED);
+        return;
+    }
+    if (!(status & ATA_STATUS_DRQ))
+    {
+        return;
+    }
+    insw(ATA_DATA_PORT, ata_pio_buf, ATA_SECTOR_WORDS);
+    ata_pio_buf += ATA_SECTOR_WORDS;
+    if (--ata_pio_left == 0)
+    {
+        // On to the next buffer of a merged command
+        ata_pio_request = ata_pio_request->next;
+        if (ata_pio_request == NULL)
+        {
+            ata_finish(ATA_REQUEST_DONE);
+            return;
+        }
+        ata_pio_buf = (uint16_t *)ata_pio_request->buf;
+        ata_pio_left = ata_pio_request->count;
+    }
+}
+
+/**
+ * @brief Handler called when interrupt occurs
+ *        Completes a DMA command or moves one PIO sector, then starts the next command
+ */
+void ata_handler(void)
+{
+    ata_service();
+    send_eoi(ATA_IRQ);
+}
+
+/**
+ * @brief Holds queued requests back so a batch can be merged
+ */
+void ata_plug(void)
+{
+    uint32_t flags;
+    cli_and_save(flags);
+    ata_plugged++;
+    restore_flags(flags);
+}
+
+/**
+ * @brief Lets held requests go to the drive
+ */
+void ata_unplug(void)
+{
+    uint32_t flags;
+    cli_and_save(flags);
+    if (ata_plugged > 0 && --ata_plugged == 0)
+    {
+        ata_start();
+    }
+    restore_flags(flags);
+}
+
+/**
+ * @brief Queues a read request without waiting for it
+ *
+ * @param req Request with lba, count (1 to 256) and buf filled in
+ * @return 0 if queued, -1 if the request is bad
+ */
+int32_t ata_submit(ata_request_t *req)
+{
+    ata_request_t **link;
+    uint32_t flags;
+
+    if (req == NULL || req->buf == NULL || req->count == 0 || req->count > ATA_MAX_SECTORS ||
+        req->lba > ATA_LBA28_MAX || req->lba >= ata_sectors || req->count > ata_sectors - req->lba)
+    {
+        return -1;
+    }
+    cli_and_save(flags);
+    req->state = ATA_REQUEST_QUEUED;
+    // Keep the queue sorted by LBA
+    link = &ata_queue;
+    while (*link != NULL && (*link)->lba <= req->lba)
+    {
+        link = &(*link)->next;
+    }
+    req->next = *link;
+    *link = req;
+    ata_start();
+    restore_flags(flags);
+    return 0;
+}
+
+/**
+ * @brief Sleeps until a submitted request is done
+ *        With interrupts on, the completion interrupt wakes the caller;
+ *        with interrupts off (boot, execute), the drive is polled instead
+ *
+ * @param req Submitted request
+ * @return Number of sectors read, -1 on failure
+ */
+int32_t ata_wait_request(ata_request_t *req)
+{
+    uint32_t flags, tries;
+    int32_t result;
+
+    cli_and_save(flags);
+    tries = 0;
+    while (req->state == ATA_REQUEST_QUEUED || req->state == ATA_REQUEST_RUNNING)
+    {
+        if (req->state == ATA_REQUEST_RUNNING &&
+            ++tries > ((flags & EFLAGS_IF) ? ATA_IRQ_TIMEOUT : ATA_TIMEOUT))
+        {
+            ata_abort();
+            tries = 0;
+            continue;
+        }
+        if (flags & EFLAGS_IF)
+        {
+            // "sti; hlt" cannot miss the wake up
+            asm volatile("sti; hlt; cli");
+        }
+        else
+        {
+            ata_service();
+        }
+    }
+    result = (req->state == ATA_REQUEST_DONE) ? (int32_t)req->count : -1;
+    req->state = ATA_REQUEST_IDLE;
+    restore_flags(flags);
+    return result;
+}
+
+/**
+ * @brief Reads sectors from the filesystem disk
+ *
+ * @param lba First sector to read
+ * @param count Number of sectors (1 to 256)
+ * @param buf Kernel buffer of at least count * 512 bytes
+ * @return Number of sectors read, -1 on failure
+ */
+int32_t ata_read_sectors(uint32_t lba, uint32_t count, void *buf)
+{
+    ata_request_t req;
+    req.lba = lba;
+    req.count = count;
+    req.buf = buf;
+    if (ata_submit(&req) == -1)
+    {
+        return -1;
+    }
+    return ata_wait_request(&req);
+}
@@ -0,0 +1,119 @@
+#ifndef ATA_H
+#define ATA_H
+
+#include "types.h"
+
+// Referenced https://wiki.osdev.org/ATA_PIO_Mode and https://wiki.osdev.org/ATA/ATAPI_using_DMA
+
+#define ATA_IRQ 14 // IRQ14: primary IDE channel
+
+// Primary channel command block registers
+#define ATA_DATA_PORT 0x1F0
+#define ATA_ERROR_PORT 0x1F1
+#define ATA_SECTOR_COUNT_PORT 0x1F2
+#define ATA_LBA_LOW_PORT 0x1F3
+#define ATA_LBA_MID_PORT 0x1F4
+#define ATA_LBA_HIGH_PORT 0x1F5
+#define ATA_DRIVE_PORT 0x1F6
+#define ATA_STATUS_PORT 0x1F7 // Reading status acknowledges the interrupt
+#define ATA_COMMAND_PORT 0x1F7
+// Primary channel control block registers
+#define ATA_CONTROL_PORT 0x3F6 // Device control on write
+#define ATA_ALT_STATUS_PORT 0x3F6 // Status without acknowledging the interrupt on read
+
+// Status register bits
+#define ATA_STATUS_ERR 0x01
+#define ATA_STATUS_DRQ 0x08
+#define ATA_STATUS_DF 0x20
+#define ATA_STATUS_BSY 0x80
+
+// Device control register bits
+#define ATA_CONTROL_NIEN 0x02 // Set to stop the drive from raising IRQ14
+#define ATA_CONTROL_SRST 0x04 // Set then cleared to reset the drives on the channel
+
+// Commands
+#define ATA_CMD_READ_SECTORS 0x20
+#define ATA_CMD_IDENTIFY 0xEC
+#define ATA_CMD_READ_DMA 0xC8
+
+// PCI class of an IDE controller; BAR4 holds its bus master registers
+#define ATA_PCI_CLASS 0x01
+#define ATA_PCI_SUBCLASS 0x01
+
+// Bus master registers of the primary channel (offsets from BAR4)
+#define ATA_BM_COMMAND 0x00
+#define ATA_BM_STATUS 0x02
+#define ATA_BM_PRDT 0x04
+#define ATA_BM_START 0x01 // Command: start the transfer
+#define ATA_BM_READ 0x08  // Command: transfer from the disk into memory
+#define ATA_BM_STATUS_ERROR 0x02
+#define ATA_BM_STATUS_IRQ 0x04 // Set once the drive has raised its interrupt
+
+// Physical region descriptor table
+#define ATA_PRD_ENTRIES 32
+#define ATA_PRD_MAX_BYTES 0x10000 // A region cannot cross a 64KB boundary
+#define ATA_PRD_END 0x8000		   // Flag on the last region of the table
+
+// Drive/head register: LBA addressing, bit 4 picks the slave
+#define ATA_DRIVE_LBA 0xE0
+#define ATA_DRIVE_SLAVE 0x10
+#define ATA_LBA28_MAX 0x0FFFFFFF
+
+#define ATA_SECTOR_SIZE 512
+#define ATA_SECTOR_WORDS 256 // 16 bit words moved per sector
+#define ATA_MAX_SECTORS 256	 // Most sectors one command can move (count register of 0)
+#define ATA_IDENTIFY_LBA28_SECTORS 60 // Words 60-61 of IDENTIFY hold the LBA28 sector count
+#define ATA_SELECT_DELAY 4	 // Alternate status reads that make up the 400ns select delay
+#define ATA_TIMEOUT 1000000	 // Status polls before giving up on the drive
+
+// Life of a request
+#define ATA_REQUEST_IDLE 0
+#define ATA_REQUEST_QUEUED 1
+#define ATA_REQUEST_RUNNING 2
+#define ATA_REQUEST_DONE 3
+#define ATA_REQUEST_FAILED 4
+
+// The filesystem disk is the primary slave ("-hdb filesys_img"); mp3.img is the master
+#define ATA_FS_DRIVE ATA_DRIVE_SLAVE
+
+/* Physical region descriptor: one run of memory a DMA transfer fills */
+typedef struct ata_prd
+{
+    uint32_t address;
+    uint16_t byte_count; // 0 means 64KB
+    uint16_t flags;
+} __attribute__((packed)) ata_prd_t;
+
+/* Read request; buf must be a kernel address since DMA uses it as a physical address */
+typedef struct ata_request
+{
+    uint32_t lba;
+    uint32_t count;
+    void *buf;
+    volatile uint32_t state;
+    struct ata_request *next; // Link in the queue, then in the merged command
+} ata_request_t;
+
+/* Looks for the filesystem disk and turns on IRQ14 */
+extern int32_t ata_init(void);
+
+/* Handler called when the drive finishes a sector or a DMA transfer */
+extern void ata_handler(void);
+
+/* Queues a request without waiting for it */
+extern int32_t ata_submit(ata_request_t *req);
+
+/* Sleeps until a submitted request is done */
+extern int32_t ata_wait_request(ata_request_t *req);
+
+/* Holds queued requests back so a batch can be merged, and lets them go */
+extern void ata_plug(void);
+extern void ata_unplug(void);
+
+/* Reads sectors from the filesystem disk */
+extern int32_t ata_read_sectors(uint32_t lba, uint32_t count, void *buf);
+
+/* Number of sectors on the filesystem disk, 0 if there is none */
+extern uint32_t ata_sector_count(void);
+
+#endif
@@ -2,152 +2,883 @@
 
 // -------------------- FUNCTIONS TO BE USED IN THE FILE DIRECTORY SYSTEM --------------------
 
+// Start of the image in memory, 0 when the image is read from the ATA disk
+static uint32_t fs_memory_start;
+
+// Number of blocks in the mounted image
+static uint32_t fs_total_blocks;
+
+// Block 0 of the image, kept for as long as the image is mounted
+static blocks_t fs_first_block;
+
+// Set when data blocks are stored compressed; those from fs_data_start on are decompressed into the block cache
+static uint32_t fs_compressed;
+static uint32_t fs_data_start;
+static uint32_t fs_image_blocks;
+static fs_compress_stats_t fs_compress_stats;
+
+// Sectors holding one stored block of a compressed disk image
+static uint8_t fs_bounce[FS_BOUNCE_SECTORS * ATA_SECTOR_SIZE];
+
+// Recently read disk blocks and decompressed blocks, replaced round robin (tag 0 is empty since block 0 is kept above)
+static blocks_t fs_cache[FS_CACHE_BLOCKS];
+static uint32_t fs_cache_tag[FS_CACHE_BLOCKS];
+static uint32_t fs_cache_next;
+
+static uint32_t inode_block_number(uint32_t inode, uint32_t index);
+static blocks_t *fs_get_block(uint32_t block);
+
+// Set while a process is using the file system
+static volatile uint32_t fs_locked;
+
+/**
+ * @brief Takes the file system lock, sleeping while another process holds it
+ *        (Reads from disk sleep with the lock held, so the holder may be switched out)
+ */
+static void fs_lock(void)
+{
+	uint32_t flags;
+	cli_and_save(flags);
+	// "sti; hlt" cannot miss the wake up
+	while (fs_locked)
+	{
+		asm volatile("sti; hlt; cli");
+	}
+	fs_locked = 1;
+	restore_flags(flags);
+}
+
+/**
+ * @brief Releases the file system lock
+ */
+static void fs_unlock(void)
+{
+	fs_locked = 0;
+}
+
+/**
+ * @brief Checks if a process is in the middle of a file system call
+ *        (Interrupt handlers must not sleep on the lock)
+ *
+ * @return 1 if the lock is held, 0 otherwise
+ */
+int32_t file_system_busy(void)
+{
+	return fs_locked;
+}
+
+/**
+ * @brief Checks if a block of the mounted image is stored compressed
+ *
+ * @param block Absolute block number
+ * @return 1 if the block has to be decompressed, 0 if it is stored as is
+ */
+static int32_t fs_block_is_packed(uint32_t block)
+{
+	return fs_compressed && block >= fs_data_start;
+}
+
+/**
+ * @brief Decompresses a data block of a compressed image (or copies it if it was stored as is)
+ *
+ * @param block Absolute block number (at least fs_data_start)
+ * @param dest Block to fill in
+ * @return 0 upon success, -1 if the table entry or the stored data is bad or the disk failed
+ */
+static int32_t fs_unpack_block(uint32_t block, blocks_t *dest)
+{
+	uint32_t index = block - fs_data_start;
+	fs2_block_entry_t entry;
+	blocks_t *table = fs_get_block(1 + global_super_block_t->inode_blocks + index / FS2_ENTRIES_PER_TABLE_BLOCK);
+	const uint8_t *src;
+	uint32_t size;
+	uint64_t start;
+	int32_t result;
+
+	if (table == NULL)
+	{
+		return -1;
+	}
+	entry = ((fs2_block_entry_t *)table)[index % FS2_ENTRIES_PER_TABLE_BLOCK];
+	size = entry.size & FS2_BLOCK_SIZE_MASK;
+	if (size == 0 || size > FILE_MEMORY_BLOCK_SIZE || entry.offset > fs_image_blocks * FILE_MEMORY_BLOCK_SIZE - size)
+	{
+		return -1;
+	}
+	if (fs_memory_start != 0)
+	{
+		src = (uint8_t *)fs_memory_start + entry.offset;
+	}
+	else
+	{
+		uint32_t first_sector = entry.offset / ATA_SECTOR_SIZE;
+		uint32_t last_sector = (entry.offset + size - 1) / ATA_SECTOR_SIZE;
+		if (ata_read_sectors(first_sector, last_sector - first_sector + 1, fs_bounce) == -1)
+		{
+			return -1;
+		}
+		src = fs_bounce + entry.offset % ATA_SECTOR_SIZE;
+	}
+
+	if (!(entry.size & FS2_BLOCK_COMPRESSED))
+	{
+		// Stored as is because it did not compress
+		if (size != FILE_MEMORY_BLOCK_SIZE)
+		{
+			return -1;
+		}
+		memcpy(dest->data, src, FILE_MEMORY_BLOCK_SIZE);
+		return 0;
+	}
+	start = rdtsc();
+	result = lz4_decompress(src, size, dest->data, FILE_MEMORY_BLOCK_SIZE);
+	fs_compress_stats.decompress_cycles += rdtsc() - start;
+	fs_compress_stats.decompressed++;
+	return (result == FILE_MEMORY_BLOCK_SIZE) ? 0 : -1;
+}
+
+/**
+ * @brief Copies the counters for reading a compressed image
+ *
+ * @param stats Destination
+ */
+void file_system_get_compress_stats(fs_compress_stats_t *stats)
+{
+	if (stats != NULL)
+	{
+		memcpy(stats, &fs_compress_stats, sizeof(fs_compress_stats));
+	}
+}
+
+/**
+ * @brief Gets a block of the image by its absolute block number
+ *        Memory images are addressed directly; disk images and compressed blocks go through the block cache
+ *
+ * @param block Absolute block number (0 is the boot/super block)
+ * @return Pointer to the block, NULL if the number is outside the image or the disk failed
+ */
+static blocks_t *fs_get_block(uint32_t block)
+{
+	uint32_t i;
+	if (block >= fs_total_blocks)
+	{
+		return NULL;
+	}
+	if (block == 0)
+	{
+		return &fs_first_block;
+	}
+	if (fs_memory_start != 0 && !fs_block_is_packed(block))
+	{
+		return (blocks_t *)fs_memory_start + block;
+	}
+
+	for (i = 0; i < FS_CACHE_BLOCKS; i++)
+	{
+		if (fs_cache_tag[i] == block)
+		{
+			if (fs_block_is_packed(block))
+			{
+				fs_compress_stats.cache_hits++;
+			}
+			return &fs_cache[i];
+		}
+	}
+	i = fs_cache_next;
+	fs_cache_next = (fs_cache_next + 1) % FS_CACHE_BLOCKS;
+	fs_cache_tag[i] = 0;
+	if (fs_block_is_packed(block))
+	{
+		// Reading the table may take the next slot, but never this one
+		if (fs_unpack_block(block, &fs_cache[i]) == -1)
+		{
+			return NULL;
+		}
+	}
+	else if (ata_read_sectors(block * FS_SECTORS_PER_BLOCK, FS_SECTORS_PER_BLOCK, fs_cache[i].data) == -1)
+	{
+		return NULL;
+	}
+	fs_cache_tag[i] = block;
+	return &fs_cache[i];
+}
+
+/**
+ * @brief Works out the format and size of the image once block 0 is in fs_first_block
+ *
+ * @param max_blocks Most blocks the backing store can hold
+ * @return 0 upon success, -1 if block 0 is not a file system that fits
+ */
+static int32_t fs_mount(uint32_t max_blocks)
+{
+	fs2_super_block_t *super_block = (fs2_super_block_t *)&fs_first_block;
+	uint32_t i;
+	for (i = 0; i < FS_CACHE_BLOCKS; i++)
+	{
+		fs_cache_tag[i] = 0;
+	}
+	global_super_block_t = super_block;
+	global_boot_block_t = (boot_block_t *)&fs_first_block;
+	fs_compressed = 0;
+	memset(&fs_compress_stats, 0, sizeof(fs_compress_stats));
+	if (super_block->magic == FS2_MAGIC && super_block->version == FS2_VERSION)
+	{
+		// Version 2: super block, then the inode table, then data blocks addressed absolutely
+		fs_version = FS_VERSION_2;
+		fs_data_start = 1 + super_block->inode_blocks;
+		fs_total_blocks = fs_data_start + super_block->block_count;
+		fs_image_blocks = fs_total_blocks;
+		if (super_block->flags & FS2_FLAG_COMPRESSED)
+		{
+			// Compressed: the block table sits between the inodes and the packed data, and data
+			// block numbers start after it as if every block were stored whole
+			fs_compressed = 1;
+			fs_data_start += super_block->table_blocks;
+			fs_total_blocks += super_block->table_blocks;
+			fs_image_blocks = super_block->image_blocks;
+		}
+		if (super_block->flags & ~FS2_FLAG_COMPRESSED)
+		{
+			// Written by a newer createfs
+			fs_version = FS_VERSION_NONE;
+		}
+	}
+	else
+	{
+		// Version 1 (Apendix A): boot block, one block per inode, then the data blocks
+		fs_version = FS_VERSION_1;
+		fs_total_blocks = 1 + global_boot_block_t->inode_number + global_boot_block_t->block_number;
+		fs_image_blocks = fs_total_blocks;
+	}
+	if (fs_version == FS_VERSION_NONE || fs_image_blocks > max_blocks)
+	{
+		fs_version = FS_VERSION_NONE;
+		fs_total_blocks = 0;
+		fs_compressed = 0;
+		return -1;
+	}
+	return 0;
+}
+
 /**
  * @brief Setup for the file system (Called when booting)
  *        Sets up the memory for the file system along with the structs with information
+ *        Mounts either a version 1 image (boot block first) or a version 2 image (super block first)
  *
  * @param start_addr Start address of file system (where boot block is to reside)
  */
 void file_system_init(unsigned int start_addr)
 {
-	// Initialize Pointers based on Apendix A image of File System
-	global_boot_block_t = (boot_block_t *)(start_addr);
-	global_dentry_t = (dentry_t *)&(global_boot_block_t->block_entires);
-	global_inode_t = (inode_t *)(start_addr + FILE_MEMORY_BLOCK_SIZE);
-	global_block_t = (blocks_t *)(start_addr + (FILE_MEMORY_BLOCK_SIZE * (global_boot_block_t->inode_number + 1)));
+	fs_memory_start = start_addr;
+	memcpy(fs_first_block.data, (void *)start_addr, FILE_MEMORY_BLOCK_SIZE);
+	// Whatever GRUB loaded is taken to hold the whole image
+	fs_mount(FS_NO_BLOCK_LIMIT);
 }
 
 /**
- * @brief Reads from file with given name and transfers data to given destination
+ * @brief Setup for the file system from the ATA disk (Called when booting)
+ *        Only block 0 is read now; every other block is read when first used
  *
- * @param fname File name (source)
- * @param dentry Data entry (destination)
- * @return 0 upon success, -1 otherwise
+ * @return 0 upon success, -1 if there is no disk or no file system on it
  */
-int32_t read_dentry_by_name(const uint8_t *fname, dentry_t *dentry)
+int32_t file_system_init_disk(void)
 {
-	uint32_t i;
-	int length_file_name = strlen((char *)fname);
-	// check for valid arguments with overlow with Magic Number 0
-	if (fname == NULL || dentry == NULL || length_file_name < 0 || length_file_name > ENTRY_NAME)
+	fs_memory_start = 0;
+	fs_version = FS_VERSION_NONE;
+	fs_total_blocks = 0;
+	if (ata_init() == -1 || ata_read_sectors(0, FS_SECTORS_PER_BLOCK, fs_first_block.data) == -1)
+	{
+		return -1;
+	}
+	if (fs_mount(ata_sector_count() / FS_SECTORS_PER_BLOCK) == -1)
 	{
 		return -1;
 	}
+	// File data is read through the page cache; the block cache keeps inodes and indirect blocks
+	// (Compressed images keep decompressed data blocks in the block cache instead)
+	if (!fs_compressed)
+	{
+		page_cache_init(inode_block_number);
+	}
+	return 0;
+}
+
+/**
+ * @brief Gets the inode of a version 1 image
+ *
+ * @param inode Inode number
+ * @return Pointer to the inode, NULL if bad inode
+ */
+static inode_t *fs1_get_inode(uint32_t inode)
+{
+	if (inode >= global_boot_block_t->inode_number)
+	{
+		return NULL;
+	}
+	return (inode_t *)fs_get_block(1 + inode);
+}
 
-	// Loop through the blocks in boot to compare and fill in block if found
-	// Use functions that have been given such as strcomp and strncpy
-	for (i = 0; i < global_boot_block_t->entries_number; i++)
+/**
+ * @brief Gets the inode of a version 2 image
+ *
+ * @param inode Inode number
+ * @return Pointer to the inode, NULL if bad inode
+ */
+static fs2_inode_t *fs2_get_inode(uint32_t inode)
+{
+	fs2_inode_t *table;
+	if (inode >= global_super_block_t->inode_count)
+	{
+		return NULL;
+	}
+	table = (fs2_inode_t *)fs_get_block(1 + inode / FS2_INODES_PER_BLOCK);
+	if (table == NULL)
+	{
+		return NULL;
+	}
+	return table + inode % FS2_INODES_PER_BLOCK;
+}
+
+/**
+ * @brief Gets a block a version 2 inode points to
+ *
+ * @param block Absolute block number from an inode or indirect block
+ * @return Pointer to the block, NULL for a hole or bad block number
+ */
+static blocks_t *fs2_get_data_block(uint32_t block)
+{
+	if (block == FS2_NO_BLOCK)
+	{
+		return NULL;
+	}
+	return fs_get_block(block);
+}
+
+/**
+ * @brief Finds the absolute number of the data block holding part of a file
+ *        (Block 0 is never a data block, so it doubles as the error value)
+ *
+ * @param inode Inode number of file
+ * @param index Index of the block within the file (offset / 4096)
+ * @return Absolute block number, 0 if bad data block number or index
+ */
+static uint32_t inode_block_number(uint32_t inode, uint32_t index)
+{
+	uint32_t block_num;
+	if (fs_version == FS_VERSION_1)
 	{
-		// check if the values are the same
-		if (strncmp((char *)fname, (char *)global_boot_block_t->block_entires[i].fileName, ENTRY_NAME) == 0)
+		inode_t *node = fs1_get_inode(inode);
+		if (node == NULL || index >= INDEX_NUMBER)
 		{
-			// copy over name, fileType and inodeNum
-			memcpy((char *)dentry->fileName, (char *)global_boot_block_t->block_entires[i].fileName, ENTRY_NAME);
-			dentry->fileType = global_boot_block_t->block_entires[i].fileType;
-			dentry->inodeNum = global_boot_block_t->block_entires[i].inodeNum;
 			return 0;
 		}
+		block_num = node->inode_data[index];
+		if (block_num >= global_boot_block_t->block_number)
+		{
+			return 0;
+		}
+		return 1 + global_boot_block_t->inode_number + block_num;
 	}
 
-	// Name not found, so there is an error in reading
-	return -1;
+	fs2_inode_t *node = fs2_get_inode(inode);
+	uint32_t *table;
+	if (node == NULL)
+	{
+		return 0;
+	}
+	// Direct blocks
+	if (index < FS2_DIRECT_BLOCKS)
+	{
+		return node->direct[index];
+	}
+	// Single indirect block
+	index -= FS2_DIRECT_BLOCKS;
+	if (index < FS2_POINTERS_PER_BLOCK)
+	{
+		table = (uint32_t *)fs2_get_data_block(node->indirect);
+		if (table == NULL)
+		{
+			return 0;
+		}
+		return table[index];
+	}
+	// Double indirect block
+	index -= FS2_POINTERS_PER_BLOCK;
+	if (index >= FS2_POINTERS_PER_BLOCK * FS2_POINTERS_PER_BLOCK)
+	{
+		return 0;
+	}
+	table = (uint32_t *)fs2_get_data_block(node->double_indirect);
+	if (table == NULL)
+	{
+		return 0;
+	}
+	table = (uint32_t *)fs2_get_data_block(table[index / FS2_POINTERS_PER_BLOCK]);
+	if (table == NULL)
+	{
+		return 0;
+	}
+	return table[index % FS2_POINTERS_PER_BLOCK];
 }
 
 /**
- * @brief Reads from file with given index and transfers data to given destination
+ * @brief Looks up the next few pages of a read in the page cache
+ *        Missing pages are queued together so the disk driver can merge neighbouring blocks
  *
- * @param index File index (source)
- * @param dentry Data entry (destination)
- * @return 0 upon success, -1 otherwise
+ * @param inode Inode number of file
+ * @param first Index of the first page wanted
+ * @param last Index of the last page the read needs
+ * @param pages Destination for up to FS_READ_BATCH pages (NULL where a page could not be had)
+ * @return Number of pages looked up
  */
-int32_t read_dentry_by_index(uint32_t index, dentry_t *dentry)
+static uint32_t fs_get_pages(uint32_t inode, uint32_t first, uint32_t last, cache_page_t **pages)
+{
+	uint32_t count = 0;
+	ata_plug();
+	while (count < FS_READ_BATCH && first + count <= last)
+	{
+		pages[count] = page_cache_get(inode, first + count, PAGE_CACHE_DEMAND);
+		count++;
+	}
+	ata_unplug();
+	return count;
+}
+
+/**
+ * @brief Gets the length of a file (caller holds the lock)
+ *
+ * @param inode Inode number of file
+ * @return Length of the file in bytes, -1 if bad inode
+ */
+static int32_t inode_length(uint32_t inode)
+{
+	if (fs_version == FS_VERSION_1)
+	{
+		inode_t *node = fs1_get_inode(inode);
+		return (node == NULL) ? -1 : (int32_t)node->length;
+	}
+	fs2_inode_t *node = fs2_get_inode(inode);
+	return (node == NULL) ? -1 : (int32_t)node->length;
+}
+
+/**
+ * @brief Gets the length to report for a directory entry (caller holds the lock)
+ *        The RTC entry has no inode, and a version 1 directory has none either
+ *        (its inode number is 0, which belongs to a regular file); a version 2
+ *        directory reports its own size
+ *
+ * @param inode Inode number from the entry
+ * @param type File type from the entry
+ * @return Length in bytes, -1 if bad inode
+ */
+static int32_t dentry_length(uint32_t inode, uint32_t type)
+{
+	if (type == USER_LEVEL_FILE_TYPE || (type == DIRECTORY_FILE_TYPE && fs_version == FS_VERSION_1))
+	{
+		return 0;
+	}
+	return inode_length(inode);
+}
+
+/**
+ * @brief Gets the length of a file
+ *
+ * @param inode Inode number of file
+ * @return Length of the file in bytes, -1 if bad inode
+ */
+int32_t get_inode_length(uint32_t inode)
+{
+	int32_t length;
+	if (fs_version == FS_VERSION_NONE)
+	{
+		return -1;
+	}
+	fs_lock();
+	length = inode_length(inode);
+	fs_unlock();
+	return length;
+}
+
+/**
+ * @brief Fills in the stat record of a file
+ *
+ * @param inode Inode number of file
+ * @param type File type from its directory entry
+ * @param info Record to fill in
+ * @return 0 upon success, -1 if bad inode
+ */
+int32_t inode_stat(uint32_t inode, uint32_t type, stat_t *info)
 {
-	uint32_t i = index;
-	// check if index fits the constraints
-	if (i >= global_boot_block_t->entries_number || i < 0)
+	int32_t length = 0;
+	if (info == NULL || fs_version == FS_VERSION_NONE)
 	{
 		return -1;
 	}
+	fs_lock();
+	length = dentry_length(inode, type);
+	fs_unlock();
+	if (length == -1)
+	{
+		return -1;
+	}
+	info->inode = inode;
+	info->type = type;
+	info->length = length;
+	info->blocks = (length + FILE_MEMORY_BLOCK_SIZE - 1) / FILE_MEMORY_BLOCK_SIZE;
+	return 0;
+}
 
-	// Copy over name, fileType and inodeNum (same code as read by name)
-	memcpy((char *)dentry->fileName, (char *)global_boot_block_t->block_entires[i].fileName, ENTRY_NAME);
-	dentry->fileType = global_boot_block_t->block_entires[i].fileType;
-	dentry->inodeNum = global_boot_block_t->block_entires[i].inodeNum;
+/**
+ * @brief Gets the inode of the root directory
+ *
+ * @return Root directory inode number
+ */
+uint32_t get_root_inode(void)
+{
+	if (fs_version == FS_VERSION_2)
+	{
+		return global_super_block_t->root_inode;
+	}
 	return 0;
 }
 
 /**
- * @brief Reads from memory and copies file information to buffer
- *        Fills buffer with data read
+ * @brief Copies file data into a buffer, one data block at a time (caller holds the lock)
+ *        A cursor remembers the file length and the last block used, so small sequential reads
+ *        that stay in one block skip the inode and indirect block lookups
  *
  * @param inode Inode number of file
- * @param offset Offset within buffer
+ * @param offset Offset within file
  * @param buf Buffer to contain data read
  * @param length Number of bytes to read (theoretical)
- * @return Number of bytes to read, 0 if end of file, -1 if bad data block number or inode
+ * @param cursor Open file to keep the cursor in, NULL for none
+ * @return Number of bytes read, 0 if end of file, -1 if bad data block number or inode
  */
-int32_t read_data(uint32_t inode, uint32_t offset, uint8_t *buf, uint32_t length)
+static int32_t fs_read_data(uint32_t inode, uint32_t offset, uint8_t *buf, uint32_t length, file_descriptor_t *cursor)
 {
-	if (inode > global_boot_block_t->inode_number)
+	int32_t file_length;
+	// The image is read only, so a cached length never goes stale
+	if (cursor != NULL && cursor->cursor_block != 0)
+	{
+		file_length = cursor->cursor_length;
+	}
+	else
+	{
+		file_length = inode_length(inode);
+	}
+	if (file_length == -1 || buf == NULL)
 	{
 		return -1;
 	}
-	uint32_t i;
-	inode_t *node = global_inode_t + inode;
-	if (offset >= node->length)
+	if (offset >= file_length)
 	{
 		return 0;
 	}
-	uint32_t block_index = offset / FILE_MEMORY_BLOCK_SIZE;
+	// Never read past the end of the file
+	if (length > file_length - offset)
+	{
+		length = file_length - offset;
+	}
 	uint32_t num_bytes_read = 0;
-	uint32_t buffer_index = 0;
-	// 1st data block
-	uint32_t block_num = node->inode_data[block_index];
-	if (block_num > global_boot_block_t->block_number)
+	uint32_t last_index = (offset + length - 1) / FILE_MEMORY_BLOCK_SIZE;
+	cache_page_t *pages[FS_READ_BATCH];
+	uint32_t batch_start = 0;
+	uint32_t batch_count = 0;
+	while (num_bytes_read < length)
+	{
+		uint32_t index = offset / FILE_MEMORY_BLOCK_SIZE;
+		uint32_t block_offset = offset % FILE_MEMORY_BLOCK_SIZE;
+		uint32_t chunk = FILE_MEMORY_BLOCK_SIZE - block_offset;
+		if (chunk > length - num_bytes_read)
+		{
+			chunk = length - num_bytes_read;
+		}
+		uint8_t *data = NULL;
+		if (fs_memory_start != 0 || fs_compressed)
+		{
+			// Memory images are already addressable and compressed blocks are kept decompressed
+			// in the block cache, so both skip the page cache
+			uint32_t block;
+			if (cursor != NULL && cursor->cursor_block != 0 && cursor->cursor_index == index)
+			{
+				block = cursor->cursor_block;
+			}
+			else
+			{
+				block = inode_block_number(inode, index);
+				if (cursor != NULL && block != 0)
+				{
+					cursor->cursor_length = file_length;
+					cursor->cursor_index = index;
+					cursor->cursor_block = block;
+				}
+			}
+			blocks_t *data_block = (block == 0) ? NULL : fs_get_block(block);
+			if (data_block != NULL)
+			{
+				data = data_block->data;
+			}
+		}
+		else
+		{
+			// Ask for the pages of this read in batches rather than one at a time
+			if (index >= batch_start + batch_count)
+			{
+				batch_start = index;
+				batch_count = fs_get_pages(inode, index, last_index, pages);
+			}
+			if (pages[index - batch_start] != NULL)
+			{
+				data = page_cache_wait(pages[index - batch_start]);
+			}
+		}
+		if (data == NULL)
+		{
+			return -1;
+		}
+		memcpy((int8_t *)buf + num_bytes_read, (int8_t *)data + block_offset, chunk);
+		num_bytes_read += chunk;
+		offset += chunk;
+	}
+	return num_bytes_read;
+}
+
+/**
+ * @brief Reads the entry at the given index of a directory (caller holds the lock)
+ *
+ * @param dir_inode Inode number of the directory (source)
+ * @param index Entry index within the directory
+ * @param dentry Data entry (destination)
+ * @return 0 upon success, -1 otherwise
+ */
+static int32_t dentry_in_directory(uint32_t dir_inode, uint32_t index, dentry_t *dentry)
+{
+	if (fs_version == FS_VERSION_1)
+	{
+		if (index >= global_boot_block_t->entries_number)
+		{
+			return -1;
+		}
+		// Copy over name, fileType and inodeNum; v1 names are not terminated when 32 chars long
+		memcpy((char *)dentry->fileName, (char *)global_boot_block_t->block_entires[index].fileName, ENTRY_NAME);
+		dentry->fileName[ENTRY_NAME] = '\0';
+		dentry->fileType = global_boot_block_t->block_entires[index].fileType;
+		dentry->inodeNum = global_boot_block_t->block_entires[index].inodeNum;
+		return 0;
+	}
+
+	fs2_dentry_t entry;
+	fs2_inode_t *dir = fs2_get_inode(dir_inode);
+	if (dir == NULL || dir->fileType != DIRECTORY_FILE_TYPE)
 	{
 		return -1;
 	}
-	blocks_t *first_block = global_block_t + block_num;
-	// If read only 1 block
-	if (offset % FILE_MEMORY_BLOCK_SIZE + length <= FILE_MEMORY_BLOCK_SIZE)
+	if (fs_read_data(dir_inode, index * sizeof(fs2_dentry_t), (uint8_t *)&entry, sizeof(fs2_dentry_t), NULL) != sizeof(fs2_dentry_t))
 	{
-		buffer_index = length;
+		return -1;
 	}
-	else
+	memcpy((char *)dentry->fileName, (char *)entry.fileName, FS2_NAME_LENGTH);
+	dentry->fileName[FS2_NAME_LENGTH] = '\0';
+	dentry->fileType = entry.fileType;
+	dentry->inodeNum = entry.inodeNum;
+	return 0;
+}
+
+/**
+ * @brief Reads the entry at the given index of a directory
+ *        (Version 1 images only have the root directory, so dir_inode is ignored)
+ *
+ * @param dir_inode Inode number of the directory (source)
+ * @param index Entry index within the directory
+ * @param dentry Data entry (destination)
+ * @return 0 upon success, -1 otherwise
+ */
+int32_t read_dentry_in_directory(uint32_t dir_inode, uint32_t index, dentry_t *dentry)
+{
+	int32_t result;
+	if (dentry == NULL || fs_version == FS_VERSION_NONE)
 	{
-		buffer_index += FILE_MEMORY_BLOCK_SIZE - (offset % FILE_MEMORY_BLOCK_SIZE);
+		return -1;
 	}
-	memcpy((int8_t *)buf, (int8_t *)first_block + (offset % FILE_MEMORY_BLOCK_SIZE), buffer_index);
-	num_bytes_read += buffer_index;
-	uint32_t cur_length = length - num_bytes_read;
-	uint32_t length_left_to_read = cur_length;
-	if (length_left_to_read == 0)
+	fs_lock();
+	result = dentry_in_directory(dir_inode, index, dentry);
+	fs_unlock();
+	return result;
+}
+
+/**
+ * @brief Looks up one name (not NUL terminated) in a directory (caller holds the lock)
+ *
+ * @param dir_inode Inode number of the directory to search
+ * @param name Name to look for
+ * @param name_length Number of characters in name
+ * @param dentry Data entry (destination)
+ * @return 0 upon success, -1 if the name is not in the directory
+ */
+static int32_t lookup_in_directory(uint32_t dir_inode, const uint8_t *name, uint32_t name_length, dentry_t *dentry)
+{
+	uint32_t i;
+	for (i = 0; dentry_in_directory(dir_inode, i, dentry) == 0; i++)
 	{
-		return num_bytes_read;
+		if (strncmp((int8_t *)name, (int8_t *)dentry->fileName, name_length) == 0 && dentry->fileName[name_length] == '\0')
+		{
+			return 0;
+		}
 	}
-	// Iterate through each data block and check if condition is met
-	// Copy data over to buffer if met
-	for (i = 1; i <= (1 + (length_left_to_read / FILE_MEMORY_BLOCK_SIZE)); i++)
+	return -1;
+}
+
+/**
+ * @brief Resolves a version 2 path one component at a time from the root (caller holds the lock)
+ *
+ * @param fname Path to resolve
+ * @param dentry Data entry (destination)
+ * @return 0 upon success, -1 otherwise
+ */
+static int32_t lookup_path(const uint8_t *fname, dentry_t *dentry)
+{
+	dentry->fileName[0] = '\0';
+	dentry->fileType = DIRECTORY_FILE_TYPE;
+	dentry->inodeNum = get_root_inode();
+	const uint8_t *component = fname;
+	while (*component != '\0')
 	{
-		uint32_t block_num = node->inode_data[block_index + i];
-		if (block_num > global_boot_block_t->block_number)
+		// Skip repeated and leading slashes
+		if (*component == '/')
+		{
+			component++;
+			continue;
+		}
+		uint32_t component_length = 0;
+		while (component[component_length] != '\0' && component[component_length] != '/')
+		{
+			component_length++;
+		}
+		if (component_length > FS2_NAME_LENGTH || dentry->fileType != DIRECTORY_FILE_TYPE)
 		{
 			return -1;
 		}
-		blocks_t *data_block = global_block_t + block_num;
-		if (i < (1 + (length_left_to_read / FILE_MEMORY_BLOCK_SIZE)))
+		// Look for the component in the current directory
+		if (lookup_in_directory(dentry->inodeNum, component, component_length, dentry) == -1)
 		{
-			memcpy((int8_t *)(buf + buffer_index + (i - 1) * FILE_MEMORY_BLOCK_SIZE), (int8_t *)data_block, FILE_MEMORY_BLOCK_SIZE);
-			num_bytes_read += FILE_MEMORY_BLOCK_SIZE;
-			cur_length -= FILE_MEMORY_BLOCK_SIZE;
+			return -1;
 		}
-		else if (i == (1 + (length_left_to_read / FILE_MEMORY_BLOCK_SIZE)))
+		component += component_length;
+	}
+	return 0;
+}
+
+/**
+ * @brief Reads from file with given name and transfers data to given destination
+ *        Version 2 names may be paths ("dir/file") resolved from the root directory
+ *
+ * @param fname File name (source)
+ * @param dentry Data entry (destination)
+ * @return 0 upon success, -1 otherwise
+ */
+int32_t read_dentry_by_name(const uint8_t *fname, dentry_t *dentry)
+{
+	uint32_t i;
+	int32_t result;
+	if (fname == NULL || dentry == NULL || fs_version == FS_VERSION_NONE)
+	{
+		return -1;
+	}
+	int length_file_name = strlen((char *)fname);
+
+	if (fs_version == FS_VERSION_1)
+	{
+		// check for valid arguments with overlow with Magic Number 0
+		if (length_file_name <= 0 || length_file_name > ENTRY_NAME)
+		{
+			return -1;
+		}
+		// Loop through the blocks in boot to compare and fill in block if found
+		for (i = 0; i < global_boot_block_t->entries_number; i++)
 		{
-			memcpy((int8_t *)buf + buffer_index + ((i - 1) * FILE_MEMORY_BLOCK_SIZE), (int8_t *)data_block, cur_length);
-			num_bytes_read += cur_length;
+			// check if the values are the same
+			if (strncmp((char *)fname, (char *)global_boot_block_t->block_entires[i].fileName, ENTRY_NAME) == 0)
+			{
+				return read_dentry_in_directory(0, i, dentry);
+			}
 		}
+		// Name not found, so there is an error in reading
+		return -1;
 	}
-	return num_bytes_read;
+
+	if (length_file_name <= 0 || length_file_name > MAX_PATH_LENGTH)
+	{
+		return -1;
+	}
+	fs_lock();
+	result = lookup_path(fname, dentry);
+	fs_unlock();
+	return result;
+}
+
+/**
+ * @brief Reads from file with given index and transfers data to given destination
+ *        (Indexes the root directory)
+ *
+ * @param index File index (source)
+ * @param dentry Data entry (destination)
+ * @return 0 upon success, -1 otherwise
+ */
+int32_t read_dentry_by_index(uint32_t index, dentry_t *dentry)
+{
+	return read_dentry_in_directory(get_root_inode(), index, dentry);
+}
+
+/**
+ * @brief Reads from memory and copies file information to buffer
+ *        Fills buffer with data read, one data block at a time
+ *
+ * @param inode Inode number of file
+ * @param offset Offset within file
+ * @param buf Buffer to contain data read
+ * @param length Number of bytes to read (theoretical)
+ * @return Number of bytes to read, 0 if end of file, -1 if bad data block number or inode
+ */
+int32_t read_data(uint32_t inode, uint32_t offset, uint8_t *buf, uint32_t length)
+{
+	int32_t result;
+	if (fs_version == FS_VERSION_NONE)
+	{
+		return -1;
+	}
+	fs_lock();
+	result = fs_read_data(inode, offset, buf, length, NULL);
+	fs_unlock();
+	return result;
+}
+
+/**
+ * @brief Starts reading the pages after a sequential reader's position into the page cache
+ *        (Does not wait for the disk; memory and compressed images have nothing to read ahead)
+ *
+ * @param inode Inode number of file
+ * @param offset Position the reader has reached
+ * @param pages Number of pages to read ahead
+ */
+void read_data_ahead(uint32_t inode, uint32_t offset, uint32_t pages)
+{
+	uint32_t index, i;
+	int32_t file_length;
+	if (fs_version == FS_VERSION_NONE || fs_memory_start != 0 || fs_compressed)
+	{
+		return;
+	}
+	fs_lock();
+	file_length = inode_length(inode);
+	// The page holding offset was just read, so start with the first page after it
+	index = (offset + FILE_MEMORY_BLOCK_SIZE - 1) / FILE_MEMORY_BLOCK_SIZE;
+	ata_plug();
+	for (i = 0; i < pages && (index + i) * FILE_MEMORY_BLOCK_SIZE < file_length; i++)
+	{
+		page_cache_get(inode, index + i, PAGE_CACHE_READAHEAD);
+	}
+	ata_unplug();
+	fs_unlock();
 }
 
 // ------------------------------ FILE FUNCTIONS ------------------------------
@@ -187,18 +918,110 @@ int32_t file_close(int32_t fd)
  */
 int32_t file_read(int32_t fd, void *buf, int32_t nbytes)
 {
-	// Check name and buffer is not NULL
-	if (fd >= MAX_FD || fd < 0 || buf == NULL)
+	// Check fd is open and buffer is not NULL
+	file_descriptor_t *file_descriptor = find_pcb(fd);
+	if (file_descriptor == 0 || buf == NULL)
 	{
 		return -1;
 	}
 
-	file_descriptor_t *file_descriptor = find_pcb(fd);
-	int32_t num_byte_read = read_data(file_descriptor->inode, file_descriptor->file_position, buf, nbytes);
-	file_descriptor->file_position += num_byte_read;
+	// A read starting where the last one ended is sequential, so the read-ahead window grows
+	if (file_descriptor->file_position == file_descriptor->readahead_next)
+	{
+		file_descriptor->readahead_pages = file_descriptor->readahead_pages * 2;
+		if (file_descriptor->readahead_pages < FS_READAHEAD_MIN)
+		{
+			file_descriptor->readahead_pages = FS_READAHEAD_MIN;
+		}
+		if (file_descriptor->readahead_pages > FS_READAHEAD_MAX)
+		{
+			file_descriptor->readahead_pages = FS_READAHEAD_MAX;
+		}
+	}
+	else
+	{
+		file_descriptor->readahead_pages = 0;
+	}
+	if (fs_version == FS_VERSION_NONE)
+	{
+		return -1;
+	}
+	fs_lock();
+	int32_t num_byte_read = fs_read_data(file_descriptor->inode, file_descriptor->file_position, buf, nbytes, file_descriptor);
+	fs_unlock();
+	if (num_byte_read > 0)
+	{
+		file_descriptor->file_position += num_byte_read;
+		file_descriptor->readahead_next = file_descriptor->file_position;
+		read_data_ahead(file_descriptor->inode, file_descriptor->file_position, file_descriptor->readahead_pages);
+	}
 	return num_byte_read;
 }
 
+/**
+ * @brief Reads a file at a given offset without moving the shared file position
+ *        (Read-ahead state is left alone too, so random reads do not disturb a sequential reader)
+ *
+ * @param fd Index
+ * @param buf Buffer to read into
+ * @param nbytes Number of bytes to read
+ * @param offset Offset within file
+ * @return Number of bytes read, 0 if offset is at or past the end of file, -1 otherwise
+ */
+int32_t file_pread(int32_t fd, void *buf, int32_t nbytes, uint32_t offset)
+{
+	file_descriptor_t *file_descriptor = find_pcb(fd);
+	if (file_descriptor == 0 || buf == NULL || nbytes < 0)
+	{
+		return -1;
+	}
+	return read_data(file_descriptor->inode, offset, buf, nbytes);
+}
+
+/**
+ * @brief Moves the file position of an open file
+ *        (Positions past the end are allowed; reads there return 0)
+ *
+ * @param fd Index
+ * @param offset Signed distance from the point given by whence
+ * @param whence SEEK_SET, SEEK_CUR or SEEK_END
+ * @return New file position, -1 if it would be negative or whence is bad
+ */
+int32_t file_lseek(int32_t fd, int32_t offset, int32_t whence)
+{
+	int32_t base;
+	file_descriptor_t *file_descriptor = find_pcb(fd);
+	if (file_descriptor == 0)
+	{
+		return -1;
+	}
+	switch (whence)
+	{
+	case SEEK_SET:
+		base = 0;
+		break;
+	case SEEK_CUR:
+		base = file_descriptor->file_position;
+		break;
+	case SEEK_END:
+		base = get_inode_length(file_descriptor->inode);
+		if (base == -1)
+		{
+			return -1;
+		}
+		break;
+	default:
+		return -1;
+	}
+	// The position has to stay a non-negative int32_t so it can be returned
+	if ((offset < 0 && base + offset < 0) || (offset > 0 && base > INT32_MAX - offset))
+	{
+		return -1;
+	}
+	file_descriptor->file_position = base + offset;
+	return file_descriptor->file_position;
+}
+
 /**
  * @brief Writes to file
  *        (Since file system is read-only, nothing is written)
@@ -224,7 +1047,6 @@ int32_t file_write(int32_t fd, const void *buf, int32_t nbytes)
  */
 int32_t directory_open(const uint8_t *filename)
 {
-	dir_position = 0;
 	return 0;
 }
 
@@ -242,44 +1064,125 @@ int32_t directory_close(int32_t fd)
 
 /**
  * @brief Reads a dentry
- *		  Fills buffer with the directory to be printed
+ *		  Fills buffer with the name of the next entry of the open directory
+ *		  (The entry index is kept in the file position of the descriptor)
  *
  * @param fd Index
  * @param buf Buffer to write to
  * @param nbytes Length of buffer
- * @return Number of characters in dentry name (0 upon failure)
+ * @return Number of characters copied from the dentry name (0 once every entry has been read)
  */
 int32_t directory_read(int32_t fd, void *buf, int32_t nbytes)
 {
-	uint8_t *buf_ptr = (uint8_t *)buf;
-	if (dir_position > global_boot_block_t->entries_number)
-	{
-		return 0;
-	}
-
-	uint32_t i;
-	for (i = 0; i < ENTRY_NAME; i++)
+	file_descriptor_t *file_descriptor = find_pcb(fd);
+	if (file_descriptor == 0 || buf == NULL || nbytes < 0)
 	{
-		buf_ptr[i] = 0;
+		return -1;
 	}
 
 	// Find the dentry by index and use the info in dentry to update the buffer
 	dentry_t den;
-	if (read_dentry_by_index(dir_position, &den) == -1)
+	if (read_dentry_in_directory(file_descriptor->inode, file_descriptor->file_position, &den) == -1)
 	{
 		return 0;
 	}
+	file_descriptor->file_position++;
 
-	memcpy((uint8_t *)buf, (int8_t *)den.fileName, strlen((int8_t *)den.fileName));
-	dir_position++;
+	// Names longer than the buffer are cut off
+	uint32_t name_length = strlen((int8_t *)den.fileName);
+	if (name_length > nbytes)
+	{
+		name_length = nbytes;
+	}
+	memcpy((uint8_t *)buf, (int8_t *)den.fileName, name_length);
+	return name_length;
+}
 
-	// For very large text
-	if (strlen((int8_t *)den.fileName) > ENTRY_NAME)
+/**
+ * @brief Fills a buffer with as many entries of the open directory as fit
+ *		  Each record carries the inode, type and length along with the name,
+ *		  so a listing needs no extra opens (entry index kept in the file position)
+ *
+ * @param fd Index
+ * @param buf Buffer to write dirent_t records to
+ * @param nbytes Length of buffer
+ * @return Bytes of records written, 0 once every entry has been read, -1 for fail (or a buffer too small for one record)
+ */
+int32_t directory_getdents(int32_t fd, void *buf, int32_t nbytes)
+{
+	file_descriptor_t *file_descriptor = find_pcb(fd);
+	if (file_descriptor == 0 || buf == NULL || nbytes <= 0 || fs_version == FS_VERSION_NONE)
 	{
-		return ENTRY_NAME;
+		return -1;
 	}
 
-	return strlen((int8_t *)den.fileName);
+	dentry_t den;
+	int32_t used = 0;
+	int32_t result = 0;
+	// One lock for the whole batch rather than one per entry
+	fs_lock();
+	while (dentry_in_directory(file_descriptor->inode, file_descriptor->file_position, &den) == 0)
+	{
+		uint32_t name_length = strlen((int8_t *)den.fileName);
+		uint32_t record_length = (sizeof(dirent_t) + name_length + 1 + DIRENT_ALIGN - 1) & ~(DIRENT_ALIGN - 1);
+		if (used + record_length > nbytes)
+		{
+			// Not even one record fits
+			if (used == 0)
+			{
+				result = -1;
+			}
+			break;
+		}
+		dirent_t *record = (dirent_t *)((uint8_t *)buf + used);
+		record->inode = den.inodeNum;
+		record->type = den.fileType;
+		record->length = dentry_length(den.inodeNum, den.fileType);
+		record->record_length = record_length;
+		record->name_length = name_length;
+		memcpy(record->name, den.fileName, name_length + 1);
+		used += record_length;
+		file_descriptor->file_position++;
+	}
+	fs_unlock();
+	return (result == -1) ? -1 : used;
+}
+
+/**
+ * @brief Moves to another entry of an open directory
+ *        (The position of a directory counts entries, so there is no SEEK_END)
+ *
+ * @param fd Index
+ * @param offset Signed number of entries from the point given by whence
+ * @param whence SEEK_SET or SEEK_CUR
+ * @return New entry index, -1 if it would be negative or whence is bad
+ */
+int32_t directory_lseek(int32_t fd, int32_t offset, int32_t whence)
+{
+	int32_t base;
+	file_descriptor_t *file_descriptor = find_pcb(fd);
+	if (file_descriptor == 0)
+	{
+		return -1;
+	}
+	if (whence == SEEK_SET)
+	{
+		base = 0;
+	}
+	else if (whence == SEEK_CUR)
+	{
+		base = file_descriptor->file_position;
+	}
+	else
+	{
+		return -1;
+	}
+	if (base + offset < 0)
+	{
+		return -1;
+	}
+	file_descriptor->file_position = base + offset;
+	return file_descriptor->file_position;
 }
 
 /**
@@ -295,3 +1198,57 @@ int32_t directory_write(int32_t fd, const void *buf, int32_t nbytes)
 {
 	return -1;
 }
+
+/**
+ * @brief Gives the stat record of an open file
+ *
+ * @param fd Index
+ * @param info Stat record to fill
+ * @return 0 upon success, -1 otherwise
+ */
+int32_t file_fstat(int32_t fd, stat_t *info)
+{
+	file_descriptor_t *file_descriptor = find_pcb(fd);
+	if (file_descriptor == 0)
+	{
+		return -1;
+	}
+	return inode_stat(file_descriptor->inode, REGULAR_FILE_TYPE, info);
+}
+
+/**
+ * @brief Gives the stat record of an open directory
+ *
+ * @param fd Index
+ * @param info Stat record to fill
+ * @return 0 upon success, -1 otherwise
+ */
+int32_t directory_fstat(int32_t fd, stat_t *info)
+{
+	file_descriptor_t *file_descriptor = find_pcb(fd);
+	if (file_descriptor == 0)
+	{
+		return -1;
+	}
+	return inode_stat(file_descriptor->inode, DIRECTORY_FILE_TYPE, info);
+}
+
+const file_operations_table_t file_table = {
+	.open = file_open,
+	.close = file_close,
+	.read = file_read,
+	.write = file_write,
+	.lseek = file_lseek,
+	.pread = file_pread,
+	.fstat = file_fstat,
+};
+
+const file_operations_table_t directory_table = {
+	.open = directory_open,
+	.close = directory_close,
+	.read = directory_read,
+	.write = directory_write,
+	.getdents = directory_getdents,
+	.lseek = directory_lseek,
+	.fstat = directory_fstat,
+};
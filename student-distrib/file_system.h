@@ -2,8 +2,12 @@
 #define FILE_SYSTEM_H
 
 #include "types.h"
+#include "vfs.h"
 #include "lib.h"
 #include "system_call.h"
+#include "ata.h"
+#include "page_cache.h"
+#include "lz4.h"
 
 #define FILE_START_POSITION 0		// Change if need be to change base of the start position
 #define FILE_MEMORY_BLOCK_SIZE 4096 // 4kb of mem per block
@@ -19,7 +23,43 @@
 #define FIRST_ENTRY_RESERVED 24 // the first entry holds the 24b from boot
 #define INDEX_NUMBER 1023
 
-#define MAX_FD 8
+// Version 2 on-image format
+#define FS2_MAGIC 0x32463933			// "39F2" as the first 4 bytes of the image
+#define FS2_VERSION 2					// Version stored in the super block
+#define FS2_NAME_LENGTH 120				// 120b per name of a v2 directory entry
+#define FS2_INODE_SIZE 64				// 64b of mem per v2 inode
+#define FS2_INODES_PER_BLOCK 64			// 4096 / 64 inodes in every inode block
+#define FS2_DIRECT_BLOCKS 12			// Data blocks addressed straight from the inode
+#define FS2_POINTERS_PER_BLOCK 1024		// 4096 / 4 block numbers in an indirect block
+#define FS2_SUPER_BLOCK_RESERVED 4060	// Pads the super block out to a full block
+#define FS2_NO_BLOCK 0					// Block 0 is the super block so it marks a hole
+#define FS2_ROOT_INODE 0				// Root directory always lives in inode 0
+
+// Compressed version 2 images: data blocks are packed after a table giving where each one is stored
+#define FS2_FLAG_COMPRESSED 0x1			// Super block flag
+#define FS2_BLOCK_COMPRESSED 0x80000000 // Set in a table entry's size if the block is LZ4 compressed
+#define FS2_BLOCK_SIZE_MASK 0xFFFF		// Stored bytes in a table entry's size
+#define FS2_ENTRIES_PER_TABLE_BLOCK 512 // 4096 / 8 table entries in every table block
+
+#define FS_VERSION_NONE 0
+#define FS_VERSION_1 1
+#define FS_VERSION_2 2
+
+#define MAX_NAME_LENGTH FS2_NAME_LENGTH // Longest file name either format can hold
+#define MAX_PATH_LENGTH 256				// Longest path accepted by open and lookups
+
+#define FS_SECTORS_PER_BLOCK (FILE_MEMORY_BLOCK_SIZE / ATA_SECTOR_SIZE)
+#define FS_NO_BLOCK_LIMIT 0xFFFFFFFF
+#define FS_CACHE_BLOCKS 16 // Disk blocks kept in memory when the image is on the ATA disk
+#define FS_READ_BATCH 8	   // Pages of one read requested from the disk together
+#define FS_READAHEAD_MIN 2  // Pages read ahead once a reader looks sequential
+#define FS_READAHEAD_MAX 16 // Read-ahead window stops doubling here
+#define FS_BOUNCE_SECTORS 9 // Sectors a stored block can touch (4096 bytes at any byte offset)
+
+// Where an lseek offset is measured from
+#define SEEK_SET 0 // Start of the file
+#define SEEK_CUR 1 // Current file position
+#define SEEK_END 2 // End of the file
 
 // structs used to manage memory
 /*Blocks*/
@@ -28,23 +68,31 @@ typedef struct blocks
 	unsigned char data[FILE_MEMORY_BLOCK_SIZE];
 } blocks_t;
 
-/* Dentry struct*/
+/* Dentry struct (kernel copy of an entry from either format; name is always NUL terminated)*/
 typedef struct dentry
+{
+	unsigned char fileName[MAX_NAME_LENGTH + 1];
+	unsigned int fileType;
+	unsigned int inodeNum;
+} dentry_t;
+
+/* Version 1 on-image dentry struct*/
+typedef struct v1_dentry
 {
 	unsigned char fileName[ENTRY_NAME];
 	unsigned int fileType;
 	unsigned int inodeNum;
 	unsigned char reserved[FIRST_ENTRY_RESERVED];
-} dentry_t;
+} v1_dentry_t;
 
-/* Boot Block struct - depends on the dentry struct*/
+/* Boot Block struct - depends on the v1 dentry struct*/
 typedef struct bootBlock
 {
 	unsigned int entries_number;
 	unsigned int inode_number;
 	unsigned int block_number;
 	unsigned char reserved[BOOT_BLOCK_RESERVED];
-	dentry_t block_entires[MAX_FILES];
+	v1_dentry_t block_entires[MAX_FILES];
 } boot_block_t;
 
 /* inode struct*/
@@ -54,30 +102,117 @@ typedef struct inode
 	unsigned int inode_data[INDEX_NUMBER];
 } inode_t;
 
-// Reference Table to points in memory for structs defined above and Global Variables
-blocks_t *global_block_t;
-dentry_t *global_dentry_t;
+/* Version 2 super block struct (block 0 of a v2 image)*/
+typedef struct fs2_super_block
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int inode_count;
+	unsigned int inode_blocks;
+	unsigned int block_count;
+	unsigned int root_inode;
+	unsigned int flags;
+	unsigned int table_blocks; // Blocks of fs2_block_entry_t after the inode table (compressed images only)
+	unsigned int image_blocks; // Blocks the packed image takes up (compressed images only)
+	unsigned char reserved[FS2_SUPER_BLOCK_RESERVED];
+} fs2_super_block_t;
+
+/* Where a data block of a compressed version 2 image is stored*/
+typedef struct fs2_block_entry
+{
+	unsigned int offset; // Byte offset from the start of the image
+	unsigned int size;	 // Stored bytes, plus FS2_BLOCK_COMPRESSED if they are LZ4 compressed
+} fs2_block_entry_t;
+
+/* Counters for the cost of reading a compressed image*/
+typedef struct fs_compress_stats
+{
+	uint32_t decompressed;		 // Blocks decompressed into the block cache
+	uint32_t cache_hits;		 // Block lookups that found the block already decompressed
+	uint64_t decompress_cycles; // Time stamp counter cycles spent decompressing
+} fs_compress_stats_t;
+
+/* Version 2 inode struct; block numbers are absolute within the image*/
+typedef struct fs2_inode
+{
+	unsigned int length;
+	unsigned int fileType;
+	unsigned int direct[FS2_DIRECT_BLOCKS];
+	unsigned int indirect;
+	unsigned int double_indirect;
+} fs2_inode_t;
+
+/* Version 2 directory entry struct (directories are files made of these)*/
+typedef struct fs2_dentry
+{
+	unsigned int inodeNum;
+	unsigned int fileType;
+	unsigned char fileName[FS2_NAME_LENGTH];
+} fs2_dentry_t;
+
+/* Record filled in by getdents; the NUL terminated name follows and records are 4 byte aligned*/
+typedef struct dirent
+{
+	uint32_t inode;
+	uint32_t type;
+	uint32_t length;		// File size in bytes (0 for the RTC)
+	uint16_t record_length; // Bytes from this record to the next
+	uint16_t name_length;	// Characters in name, not counting the NUL
+	uint8_t name[];
+} dirent_t;
+
+#define DIRENT_ALIGN 4
+
+/* Record filled in by stat and fstat*/
+typedef struct stat
+{
+	uint32_t inode;
+	uint32_t type;
+	uint32_t length; // File size in bytes (0 for the RTC)
+	uint32_t blocks; // Data blocks the file occupies
+} stat_t;
+
+// Reference Table to block 0 of the mounted image (boot block or super block)
 boot_block_t *global_boot_block_t;
-inode_t *global_inode_t;
+fs2_super_block_t *global_super_block_t;
 
-unsigned int dir_position;
+// Format of the mounted image (FS_VERSION_1 or FS_VERSION_2)
+unsigned int fs_version;
 
 // functions to be used in the file directory system
 extern void file_system_init(unsigned int start_addr);
+extern int32_t file_system_init_disk(void);
+extern int32_t file_system_busy(void);
+extern void file_system_get_compress_stats(fs_compress_stats_t *stats);
 extern int32_t read_dentry_by_name(const uint8_t *fname, dentry_t *dentry);
 extern int32_t read_dentry_by_index(uint32_t index, dentry_t *dentry);
+extern int32_t read_dentry_in_directory(uint32_t dir_inode, uint32_t index, dentry_t *dentry);
 extern int32_t read_data(uint32_t inode, uint32_t offset, uint8_t *buf, uint32_t length);
+extern void read_data_ahead(uint32_t inode, uint32_t offset, uint32_t pages);
+extern int32_t get_inode_length(uint32_t inode);
+extern int32_t inode_stat(uint32_t inode, uint32_t type, stat_t *info);
+extern uint32_t get_root_inode(void);
+
+// Operations of open files and directories
+extern const file_operations_table_t file_table;
+extern const file_operations_table_t directory_table;
 
 // file functions
 int32_t file_open(const uint8_t *filename);
 int32_t file_close(int32_t fd);
 int32_t file_read(int32_t fd, void *buf, int32_t nbytes);
 int32_t file_write(int32_t fd, const void *buf, int32_t nbytes);
+int32_t file_pread(int32_t fd, void *buf, int32_t nbytes, uint32_t offset);
+int32_t file_lseek(int32_t fd, int32_t offset, int32_t whence);
+int32_t file_fstat(int32_t fd, stat_t *info);
 
 // directory functions
 int32_t directory_open(const uint8_t *filename);
 int32_t directory_close(int32_t fd);
 int32_t directory_read(int32_t fd, void *buf, int32_t nbytes);
 int32_t directory_write(int32_t fd, const void *buf, int32_t nbytes);
+int32_t directory_getdents(int32_t fd, void *buf, int32_t nbytes);
+int32_t directory_lseek(int32_t fd, int32_t offset, int32_t whence);
+int32_t directory_fstat(int32_t fd, stat_t *info);
 
 #endif
@@ -186,6 +186,9 @@ void idt_init(void)
     // Set handler for PIT in the IDT
     SET_IDT_ENTRY(idt[PIT_VECTOR], pit_handler_linkage);
 
+    // Set handler for the primary IDE channel in the IDT
+    SET_IDT_ENTRY(idt[ATA_VECTOR], ata_handler_linkage);
+
     // Set the offset for the system call descriptor
     SET_IDT_ENTRY(idt[SYSTEM_CALL_VECTOR], system_call_link);
 
@@ -16,6 +16,7 @@
 #define PIT_VECTOR 0x20
 #define KEYBOARD_VECTOR 0x21
 #define RTC_VECTOR 0x28
+#define ATA_VECTOR 0x2E
 #define SYSTEM_CALL_VECTOR 0x80
 
 // Prints the exception and freezes kernel
@@ -4,6 +4,7 @@
 #include "keyboard.h"
 #include "rtc.h"
 #include "scheduling.h"
+#include "ata.h"
 
 // Assembly linked handler for keyboard
 extern void keyboard_handler_linkage(void);
@@ -14,4 +15,7 @@ extern void rtc_handler_linkage(void);
 // Assembly linked handler for PIT
 extern void pit_handler_linkage(void);
 
+// Assembly linked handler for the primary IDE channel
+extern void ata_handler_linkage(void);
+
 #endif
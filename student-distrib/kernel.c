@@ -14,6 +14,8 @@
 #include "file_system.h"
 #include "system_call.h"
 #include "scheduling.h"
+#include "vfs.h"
+#include "serial.h"
 
 // #define RUN_TESTS
 
@@ -151,12 +153,22 @@ void entry(unsigned long magic, unsigned long addr)
     // Initialize the IDT
     idt_init();
 
+    // Fast system calls next to int $0x80, when the CPU has them
+    sysenter_init();
+
     /* Init the PIC */
     i8259_init();
 
-    /* Initialize file system */
-    module_t *mod = (module_t *)mbi->mods_addr;
-    file_system_init((unsigned int)mod->mod_start);
+    /* Initialize file system: from the GRUB module if there is one, otherwise from the ATA disk */
+    if (CHECK_FLAG(mbi->flags, 3) && mbi->mods_count > 0)
+    {
+        module_t *mod = (module_t *)mbi->mods_addr;
+        file_system_init((unsigned int)mod->mod_start);
+    }
+    else if (file_system_init_disk() == -1)
+    {
+        printf("No file system found on the ATA disk\n");
+    }
 
     /* Initialise paging */
     page_init();
@@ -166,8 +178,13 @@ void entry(unsigned long magic, unsigned long addr)
 
     keyboard_init();
 
+    // Built-in devices first, then the drivers that attach their own
+    vfs_init();
+
     rtc_init();
 
+    serial_init();
+
     // Disable when testing
     pit_init();
 
@@ -49,6 +49,9 @@ unsigned char keyboard_map[MAP_SIZE] =
 
 // Boolean flag for each key; 1 if key is currently being pressed; 0 if not; used for special keys
 static volatile unsigned char keys_pressed[NUM_TERMINALS][BUFFER_SIZE];
+
+// Woken on every key press in a terminal, for poll on its stdin
+static wait_queue_t stdin_wait[NUM_TERMINALS];
 // Boolean flag to determine if caps_lock is on; 1 if on; 0 if off
 // Only switches on press of caps_lock; not release
 static volatile unsigned char caps_lock_toggle;
@@ -64,6 +67,12 @@ static volatile unsigned char history[HISTORY_SIZE][BUFFER_SIZE];
 static volatile uint32_t num_history;
 // Pointer to the entry in the history array; moved using up and down arrow keys
 static volatile uint32_t cur_history_position;
+// Scancodes queued by the interrupt handler; only the handler moves head and only the deferred half moves tail
+static volatile unsigned char scancode_ring[SCANCODE_RING_SIZE];
+static volatile uint32_t scancode_head;
+static volatile uint32_t scancode_tail;
+// 1 while a deferred half is draining the ring (possibly preempted by the scheduler)
+static volatile uint32_t keyboard_deferred_running;
 
 /* Helper function to determine if a character is a letter
    Input: Character to check
@@ -122,22 +131,32 @@ int32_t autocomplete(void)
     {
         return -1;
     }
+    // Runs on whichever process the keyboard interrupted, so it cannot sleep on one reading the disk
+    if (file_system_busy())
+    {
+        return -1;
+    }
     // Get the string in the current keyboard buffer
+    // (only the deferred keyboard half changes it, so the walk below runs with interrupts on)
     uint8_t *fname = terminals[current_terminal_view].keyboard_buffer;
+    dentry_t den;
+    uint32_t flags;
     int i;
-    for (i = 0; i < global_boot_block_t->entries_number; i++)
+    for (i = 0; read_dentry_by_index(i, &den) == 0; i++)
     {
         // Find the closest file name matching the buffer
-        if (strncmp((char *)fname, (char *)global_boot_block_t->block_entires[i].fileName, terminals[current_terminal_view].keyboard_buffer_size) == 0)
+        if (strncmp((char *)fname, (char *)den.fileName, terminals[current_terminal_view].keyboard_buffer_size) == 0)
         {
             // Copy the rest of the name into the buffer
             int j;
-            for (j = terminals[current_terminal_view].keyboard_buffer_size; j < strlen((char *)global_boot_block_t->block_entires[i].fileName); j++)
+            cli_and_save(flags);
+            for (j = terminals[current_terminal_view].keyboard_buffer_size; j < strlen((char *)den.fileName); j++)
             {
-                terminals[current_terminal_view].keyboard_buffer[j] = global_boot_block_t->block_entires[i].fileName[j];
+                terminals[current_terminal_view].keyboard_buffer[j] = den.fileName[j];
                 terminal_putc(terminals[current_terminal_view].keyboard_buffer[j]);
             }
-            terminals[current_terminal_view].keyboard_buffer_size = strlen((char *)global_boot_block_t->block_entires[i].fileName);
+            terminals[current_terminal_view].keyboard_buffer_size = strlen((char *)den.fileName);
+            restore_flags(flags);
             return 0;
         }
     }
@@ -206,8 +225,8 @@ void clear_all_terminals(void)
         terminals[i].keyboard_buffer_size = 0;
         terminals[i].screen_x = 0;
         terminals[i].screen_y = 0;
-        terminals[i].factor = FACTOR_INIT;
-        terminals[i].interrupt_count = 0;
+        terminals[i].scrollback_rows = 0;
+        terminals[i].vidmap_pid = -1;
     }
     for (i = 0; i < MAP_SIZE; i++)
     {
@@ -246,149 +265,204 @@ void keyboard_init(void)
     enable_irq(KEYBOARD_IRQ);
 }
 
-/*  Keyboard interrupt handler
-    Inputs: none
+/*  Keyboard deferred half; the line discipline for one scancode
+    Inputs: keycode: scancode taken from the ring
     Outputs: none
-    Description: Reads from data_port and maps entry to a character on keyboard_map
+    Description: Tracks pressed keys, echoes and edits the keyboard buffer, and handles
+                 history, autocomplete, clearing and terminal switches
 */
-void keyboard_handler(void)
+static void keyboard_process(unsigned char keycode)
 {
-    cli();
-    unsigned char status = inb(STATUS_PORT); // Grabbing the status
-    if (status & 0x1)
-    {                                           // If last bit = 1, handle a new keypress
-        unsigned char keycode = inb(DATA_PORT); // Grabbing the data
-        // 128 is the number of entries in our keyboard map
-        if (keycode >= MAP_SIZE)
+    uint32_t flags;
+    // Buffers, echo and the screen are shared with terminal_read and terminal_write, which run
+    // with interrupts off, so each step on them does too; walking the directory does not
+    cli_and_save(flags);
+    // 128 is the number of entries in our keyboard map
+    if (keycode >= MAP_SIZE)
+    {
+        // Clear buffer when enter is released
+        if (keycode == ENTER_REL)
         {
-            // Clear buffer when enter is released
-            if (keycode == ENTER_REL)
-            {
-                clear_current_buffer();
-            }
-            // Keycode is released; subtract by 128 to get the key being released
-            keycode = keycode - 0x80;
-            // Set the flag for the keycode to 0 since released
-            keys_pressed[current_terminal_view][keycode] = 0;
-            // Sending an EOI to reset PIC busy state
-            send_eoi(KEYBOARD_IRQ);
-            return;
+            clear_current_buffer();
         }
-        // Key is pressed so set the flag for the keycode to 1
-        keys_pressed[current_terminal_view][keycode] = 1;
-        // If key is caps_lock
-        if (keycode == CAPS_LOCK)
+        // Keycode is released; subtract by 128 to get the key being released
+        keycode = keycode - 0x80;
+        // Set the flag for the keycode to 0 since released
+        keys_pressed[current_terminal_view][keycode] = 0;
+        restore_flags(flags);
+        return;
+    }
+    // Key is pressed so set the flag for the keycode to 1
+    keys_pressed[current_terminal_view][keycode] = 1;
+    wait_queue_wake(&stdin_wait[current_terminal_view]);
+    // Shift + PgUp/PgDn pages through the scrollback; any other key goes back to the live screen
+    if ((keys_pressed[current_terminal_view][LEFT_SHIFT] == 1) || (keys_pressed[current_terminal_view][RIGHT_SHIFT] == 1))
+    {
+        if ((keycode == PAGE_UP) || (keycode == PAGE_DOWN))
         {
-            // Invert the toggle
-            if (caps_lock_toggle == 0)
-            {
-                caps_lock_toggle = 1;
-            }
-            else
-            {
-                caps_lock_toggle = 0;
-            }
+            scrollback_page((keycode == PAGE_UP) ? 1 : -1);
+            restore_flags(flags);
+            return;
         }
-        // Finding the entry associated with data in data port
-        char character = keyboard_map[keycode];
-        // If the character is a letter, need to check shift and caps_lock
-        if (is_letter(character))
+    }
+    if ((keycode != LEFT_SHIFT) && (keycode != RIGHT_SHIFT))
+    {
+        scrollback_reset();
+    }
+    // If key is caps_lock
+    if (keycode == CAPS_LOCK)
+    {
+        // Invert the toggle
+        if (caps_lock_toggle == 0)
         {
-            // If shift is pressed XOR caps_lock is on, convert to uppercase; otherwise, shift and caps_lock is both on so keep as lowercase
-            if (!((keys_pressed[current_terminal_view][LEFT_SHIFT] == 1) || (keys_pressed[current_terminal_view][RIGHT_SHIFT] == 1)) != !(caps_lock_toggle == 1))
-            {
-                character -= 32;
-            }
+            caps_lock_toggle = 1;
         }
-        // If shift is pressed, need to check if character is special character and add offset if it is
-        if ((keys_pressed[current_terminal_view][LEFT_SHIFT] == 1) || (keys_pressed[current_terminal_view][RIGHT_SHIFT] == 1))
+        else
         {
-            character += is_special_char(character);
+            caps_lock_toggle = 0;
         }
-        // Only print for letters and special characters; not function keys such as shift
-        if (character != 0)
+    }
+    // Finding the entry associated with data in data port
+    char character = keyboard_map[keycode];
+    // If the character is a letter, need to check shift and caps_lock
+    if (is_letter(character))
+    {
+        // If shift is pressed XOR caps_lock is on, convert to uppercase; otherwise, shift and caps_lock is both on so keep as lowercase
+        if (!((keys_pressed[current_terminal_view][LEFT_SHIFT] == 1) || (keys_pressed[current_terminal_view][RIGHT_SHIFT] == 1)) != !(caps_lock_toggle == 1))
         {
-            // Add the character to the buffer as long as CTRL + l/L is not pressed
-            if ((terminals[current_terminal_view].keyboard_buffer_size < 127) && !((keys_pressed[current_terminal_view][CTRL] == 1) && (keys_pressed[current_terminal_view][L] == 1)))
-            {
-                terminals[current_terminal_view].keyboard_buffer[terminals[current_terminal_view].keyboard_buffer_size] = character;
-                terminals[current_terminal_view].keyboard_buffer_size++;
-                terminal_putc(character);
-                // If already inputted 127 characters, only accept characters if it is a newline
-            }
-            else if ((terminals[current_terminal_view].keyboard_buffer_size == 127) && (character == '\n'))
-            {
-                terminals[current_terminal_view].keyboard_buffer[terminals[current_terminal_view].keyboard_buffer_size] = character;
-                terminals[current_terminal_view].keyboard_buffer_size++;
-                terminal_putc(character);
-            }
+            character -= 32;
         }
-
-        // If backspace is pressed, erase the previous character from buffer
-        if (keys_pressed[current_terminal_view][BACKSPACE] == 1)
+    }
+    // If shift is pressed, need to check if character is special character and add offset if it is
+    if ((keys_pressed[current_terminal_view][LEFT_SHIFT] == 1) || (keys_pressed[current_terminal_view][RIGHT_SHIFT] == 1))
+    {
+        character += is_special_char(character);
+    }
+    // Only print for letters and special characters; not function keys such as shift
+    if (character != 0)
+    {
+        // Add the character to the buffer as long as CTRL + l/L is not pressed
+        if ((terminals[current_terminal_view].keyboard_buffer_size < 127) && !((keys_pressed[current_terminal_view][CTRL] == 1) && (keys_pressed[current_terminal_view][L] == 1)))
         {
-            if (terminals[current_terminal_view].keyboard_buffer_size > 0)
-            {
-                terminals[current_terminal_view].keyboard_buffer_size--;
-                // Erase the previous character on console
-                terminal_putc_backspace();
-                terminals[current_terminal_view].keyboard_buffer[terminals[current_terminal_view].keyboard_buffer_size] = 0;
-            }
+            terminals[current_terminal_view].keyboard_buffer[terminals[current_terminal_view].keyboard_buffer_size] = character;
+            terminals[current_terminal_view].keyboard_buffer_size++;
+            terminal_putc(character);
+            // If already inputted 127 characters, only accept characters if it is a newline
         }
-
-        // Clear video memory when CTRL + l/L is pressed
-        if ((keys_pressed[current_terminal_view][CTRL] == 1) && (keys_pressed[current_terminal_view][L] == 1))
+        else if ((terminals[current_terminal_view].keyboard_buffer_size == 127) && (character == '\n'))
         {
-            terminal_clear();
+            terminals[current_terminal_view].keyboard_buffer[terminals[current_terminal_view].keyboard_buffer_size] = character;
+            terminals[current_terminal_view].keyboard_buffer_size++;
+            terminal_putc(character);
         }
+    }
 
-        // Autocomplete if TAB is pressed
-        if (keys_pressed[current_terminal_view][TAB] == 1)
+    // If backspace is pressed, erase the previous character from buffer
+    if (keys_pressed[current_terminal_view][BACKSPACE] == 1)
+    {
+        if (terminals[current_terminal_view].keyboard_buffer_size > 0)
         {
-            autocomplete();
+            terminals[current_terminal_view].keyboard_buffer_size--;
+            // Erase the previous character on console
+            terminal_putc_backspace();
+            terminals[current_terminal_view].keyboard_buffer[terminals[current_terminal_view].keyboard_buffer_size] = 0;
         }
+    }
 
-        // Get history
-        if (keys_pressed[current_terminal_view][UP] == 1)
-        {
-            get_history(0);
-        }
-        else if (keys_pressed[current_terminal_view][DOWN] == 1)
-        {
-            get_history(1);
-        }
+    // Clear video memory when CTRL + l/L is pressed
+    if ((keys_pressed[current_terminal_view][CTRL] == 1) && (keys_pressed[current_terminal_view][L] == 1))
+    {
+        terminal_clear();
+    }
 
-        // Switch terminal
-        if ((keys_pressed[0][ALT] == 1) || (keys_pressed[1][ALT] == 1) || (keys_pressed[2][ALT] == 1))
+    // Autocomplete if TAB is pressed
+    if (keys_pressed[current_terminal_view][TAB] == 1)
+    {
+        restore_flags(flags);
+        autocomplete();
+        cli_and_save(flags);
+    }
+
+    // Get history
+    if (keys_pressed[current_terminal_view][UP] == 1)
+    {
+        get_history(0);
+    }
+    else if (keys_pressed[current_terminal_view][DOWN] == 1)
+    {
+        get_history(1);
+    }
+
+    // Switch terminal
+    if ((keys_pressed[0][ALT] == 1) || (keys_pressed[1][ALT] == 1) || (keys_pressed[2][ALT] == 1))
+    {
+        if (keys_pressed[current_terminal_view][F1] == 1)
         {
-            if (keys_pressed[current_terminal_view][F1] == 1)
+            if (current_terminal_view != 0)
             {
-                if (current_terminal_view != 0)
-                {
-                    keys_pressed[current_terminal_view][F1] = 0;
-                    terminal_switch(0);
-                }
+                keys_pressed[current_terminal_view][F1] = 0;
+                terminal_switch(0);
             }
-            else if (keys_pressed[current_terminal_view][F2] == 1)
+        }
+        else if (keys_pressed[current_terminal_view][F2] == 1)
+        {
+            if (current_terminal_view != 1)
             {
-                if (current_terminal_view != 1)
-                {
-                    keys_pressed[current_terminal_view][F2] = 0;
-                    terminal_switch(1);
-                }
+                keys_pressed[current_terminal_view][F2] = 0;
+                terminal_switch(1);
             }
-            else if (keys_pressed[current_terminal_view][F3] == 1)
+        }
+        else if (keys_pressed[current_terminal_view][F3] == 1)
+        {
+            if (current_terminal_view != 2)
             {
-                if (current_terminal_view != 2)
-                {
-                    keys_pressed[current_terminal_view][F3] = 0;
-                    terminal_switch(2);
-                }
+                keys_pressed[current_terminal_view][F3] = 0;
+                terminal_switch(2);
             }
         }
     }
+    restore_flags(flags);
+}
+
+/*  Keyboard interrupt handler
+    Inputs: none
+    Outputs: none
+    Description: Queues the scancode from data_port, then (unless one is already running)
+                 runs the deferred half with interrupts on until the queue is empty,
+                 so the PIT and other interrupts are not held up by echo or autocomplete
+*/
+void keyboard_handler(void)
+{
+    cli();
+    unsigned char status = inb(STATUS_PORT); // Grabbing the status
+    if (status & 0x1)
+    {                                           // If last bit = 1, handle a new keypress
+        unsigned char keycode = inb(DATA_PORT); // Grabbing the data
+        // Drop the key if the deferred half is this far behind
+        if (scancode_head - scancode_tail < SCANCODE_RING_SIZE)
+        {
+            scancode_ring[scancode_head % SCANCODE_RING_SIZE] = keycode;
+            scancode_head++;
+        }
+    }
     // Enables IRQ for keyboard on PIC
     send_eoi(KEYBOARD_IRQ);
+    // A deferred half interrupted here, or preempted on another process, picks this key up
+    if (keyboard_deferred_running)
+    {
+        return;
+    }
+    keyboard_deferred_running = 1;
+    // The queue is checked with interrupts off so a key cannot slip in after the last check
+    while (scancode_tail != scancode_head)
+    {
+        unsigned char keycode = scancode_ring[scancode_tail % SCANCODE_RING_SIZE];
+        scancode_tail++;
+        sti();
+        keyboard_process(keycode);
+        cli();
+    }
+    keyboard_deferred_running = 0;
     sti();
 }
 
@@ -489,34 +563,41 @@ int32_t terminal_read(int32_t fd, void *buf, int32_t nbytes)
 */
 int32_t terminal_write(int32_t fd, const void *buf, int32_t nbytes)
 {
-    cli();
-    // Load video data into video memory directly
-    if (current_terminal_run == current_terminal_view)
-    {
-        video_mem = (char *)VIDEO;
-    }
-    else
-    {
-        // Load video data into terminal video buffer
-        video_mem = (char *)terminal_address[current_terminal_run];
-    }
     unsigned char *buf_ptr = (unsigned char *)buf;
     if (buf_ptr == NULL || nbytes < 0)
     {
         return -1;
     }
-    int num_byte = 0;
-    unsigned int i;
-    // Print the character to the console
-    for (i = 0; i < nbytes; i++)
-    {
-        putc(buf_ptr[i]);
-        // Check if the buffer contains null character
-        if (buf_ptr[i] != '\0')
-        {
-            num_byte++;
-        }
-    }
+    cli();
+    // Every terminal writes to its own video page, on screen or not
+    video_mem = terminal_screen(current_terminal_run);
+    // Print the whole buffer to the console at once; null characters are not counted
+    int num_byte = putbuf(buf_ptr, nbytes);
     sti();
     return num_byte;
 }
+
+/*  Terminal poll; stdin is readable once terminal_read would stop waiting
+    Inputs: fd: file descriptor used
+            queue: set to the queue woken on key presses in this terminal
+    Outputs: POLLIN if a line is waiting, else 0
+*/
+static uint32_t terminal_poll(int32_t fd, wait_queue_t **queue)
+{
+    *queue = &stdin_wait[current_terminal_run];
+    return (keys_pressed[current_terminal_run][ENTER] == 1 && current_terminal_run == current_terminal_view) ? POLLIN : 0;
+}
+
+// stdin only reads and stdout only writes; neither has a position or a stat record
+const file_operations_table_t stdin_table = {
+    .open = terminal_open,
+    .close = terminal_close,
+    .read = terminal_read,
+    .poll = terminal_poll,
+};
+
+const file_operations_table_t stdout_table = {
+    .open = terminal_open,
+    .close = terminal_close,
+    .write = terminal_write,
+};
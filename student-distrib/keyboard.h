@@ -7,6 +7,7 @@
 */
 
 #include "lib.h"
+#include "vfs.h"
 #include "i8259.h"
 #include "scheduling.h"
 #include "system_call.h"
@@ -63,9 +64,16 @@
 #define UP 0x48
 #define DOWN 0x50
 
+/* Keycode for page up/down pressed; with shift they page through the scrollback */
+#define PAGE_UP 0x49
+#define PAGE_DOWN 0x51
+
 /* Max number of history entries */
 #define HISTORY_SIZE 100
 
+/* Scancodes the interrupt handler can queue for the deferred half; a power of 2 */
+#define SCANCODE_RING_SIZE 64
+
 typedef struct terminal
 {
   int32_t current_pid;
@@ -73,8 +81,12 @@ typedef struct terminal
   int32_t screen_y;
   int32_t view_screen_x;
   int32_t view_screen_y;
-  int32_t interrupt_count;
-  int32_t factor;
+  // Row of the terminal's video region shown at the top of the screen
+  int32_t top_row;
+  // Process that mapped the screen through vidmap, -1 if none; its screen stays at the start of the region
+  int32_t vidmap_pid;
+  // Rows that have ever scrolled off the screen into the scrollback
+  uint32_t scrollback_rows;
   // Keyboard buffer for each terminal
   uint8_t keyboard_buffer[BUFFER_SIZE];
   // Stores the current number of characters in the buffer for each terminal
@@ -115,4 +127,8 @@ extern int32_t terminal_read(int32_t fd, void *buf, int32_t nbytes);
 /* Writes to the screen from buffer */
 extern int32_t terminal_write(int32_t fd, const void *buf, int32_t nbytes);
 
+/* Operations of stdin (read only) and stdout (write only) */
+extern const file_operations_table_t stdin_table;
+extern const file_operations_table_t stdout_table;
+
 #endif
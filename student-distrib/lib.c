@@ -7,6 +7,15 @@
 #define NUM_COLS 80
 #define NUM_ROWS 25
 #define ATTRIB 0x7
+// Rows that fit in a terminal's video region
+#define TERMINAL_ROWS (TERMINAL_VIDEO_SIZE / (NUM_COLS << 1))
+// Rows kept per terminal after they scroll off the screen
+#define SCROLLBACK_ROWS 2048
+
+// Ring of the rows that scrolled off each terminal; the oldest is overwritten first
+static uint16_t scrollback[NUM_TERMINALS][SCROLLBACK_ROWS][NUM_COLS];
+// Rows the viewed terminal is scrolled back; 0 when the live screen is shown
+static int32_t scrollback_offset = 0;
 
 /* void clear(void);
  * Inputs: void
@@ -37,8 +46,8 @@ void terminal_clear(void)
     int32_t i;
     for (i = 0; i < NUM_ROWS * NUM_COLS; i++)
     {
-        *(uint8_t *)((char *)VIDEO + (i << 1)) = ' ';
-        *(uint8_t *)((char *)VIDEO + (i << 1) + 1) = ATTRIB;
+        *(uint8_t *)(terminal_screen(current_terminal_view) + (i << 1)) = ' ';
+        *(uint8_t *)(terminal_screen(current_terminal_view) + (i << 1) + 1) = ATTRIB;
     }
     terminals[current_terminal_view].screen_x = 0;
     terminals[current_terminal_view].screen_y = 0;
@@ -180,23 +189,185 @@ int32_t printf(int8_t *format, ...)
     return (buf - format);
 }
 
+/* char* terminal_screen(int32_t terminal);
+ * Inputs: int32_t terminal = which terminal
+ * Return Value: Address of the first character on the terminal's screen
+ * Function: The screen is a window onto the terminal's video region that moves down as it scrolls */
+char *terminal_screen(int32_t terminal)
+{
+    return (char *)terminal_address[terminal] + ((NUM_COLS * terminals[terminal].top_row) << 1);
+}
+
+/* uint16_t* scrollback_row(int32_t terminal, int32_t back);
+ * Inputs: int32_t terminal = which terminal
+ *         int32_t back = how many rows above the screen (1 is the row just above it)
+ * Return Value: The row in the scrollback ring, NULL if it is no longer kept
+ * Function: Finds a row that has scrolled off the screen */
+static uint16_t *scrollback_row(int32_t terminal, int32_t back)
+{
+    if (back < 1 || back > SCROLLBACK_ROWS || (uint32_t)back > terminals[terminal].scrollback_rows)
+    {
+        return NULL;
+    }
+    return scrollback[terminal][(terminals[terminal].scrollback_rows - back) % SCROLLBACK_ROWS];
+}
+
+/* void scroll_terminal(int32_t terminal, int32_t rows);
+ * Inputs: int32_t terminal = which terminal
+ *         int32_t rows = how many rows to scroll up
+ * Return Value: none
+ * Function: Scrolls by moving the screen down the terminal's video region and blanking the rows
+ *           it uncovers. Only when the screen would run past the end of the region are the rows
+ *           that stay copied back to its start. A terminal whose screen a program has mapped
+ *           through vidmap always takes the copy, so the screen stays where the program draws.
+ *           The CRTC start address and video_mem follow.
+ *           The rows that leave go to the scrollback; rows scrolled past without ever being on
+ *           screen get blank slots there, which putbuf writes into directly. */
+void scroll_terminal(int32_t terminal, int32_t rows)
+{
+    uint16_t *cells = (uint16_t *)terminal_screen(terminal);
+    uint16_t *row;
+    int32_t kept = (rows < NUM_ROWS) ? NUM_ROWS - rows : 0;
+    int32_t i, j;
+
+    for (i = 0; i < rows; i++)
+    {
+        row = scrollback[terminal][terminals[terminal].scrollback_rows % SCROLLBACK_ROWS];
+        if (i < NUM_ROWS)
+        {
+            memcpy(row, cells + NUM_COLS * i, NUM_COLS << 1);
+        }
+        else
+        {
+            for (j = 0; j < NUM_COLS; j++)
+            {
+                row[j] = ' ' | (ATTRIB << EIGHT);
+            }
+        }
+        terminals[terminal].scrollback_rows++;
+    }
+
+    if (terminals[terminal].vidmap_pid == -1 && terminals[terminal].top_row + NUM_ROWS + rows <= TERMINAL_ROWS)
+    {
+        terminals[terminal].top_row += rows;
+    }
+    else
+    {
+        // Wrap around to the start of the region, or scroll in place for a vidmapped screen
+        memmove((uint8_t *)terminal_address[terminal], (uint8_t *)(terminal_screen(terminal) + ((NUM_COLS * (NUM_ROWS - kept)) << 1)), (kept * NUM_COLS) << 1);
+        terminals[terminal].top_row = 0;
+    }
+    cells = (uint16_t *)terminal_screen(terminal);
+    for (i = kept * NUM_COLS; i < NUM_ROWS * NUM_COLS; i++)
+    {
+        cells[i] = ' ' | (ATTRIB << EIGHT);
+    }
+    if (terminal == current_terminal_run)
+    {
+        video_mem = terminal_screen(terminal);
+    }
+    // New lines on screen bring the view back down from the scrollback
+    if (terminal == current_terminal_view)
+    {
+        scrollback_offset = 0;
+        set_display_start((uint32_t)terminal_screen(terminal));
+    }
+}
+
+/* void home_terminal(int32_t terminal);
+ * Inputs: int32_t terminal = which terminal
+ * Return Value: none
+ * Function: Copies the screen back to the start of the terminal's video region, so it starts on a
+ *           page boundary (vidmap hands programs a page and expects the screen at its start) */
+void home_terminal(int32_t terminal)
+{
+    if (terminals[terminal].top_row == 0)
+    {
+        return;
+    }
+    memmove((uint8_t *)terminal_address[terminal], (uint8_t *)terminal_screen(terminal), (NUM_ROWS * NUM_COLS) << 1);
+    terminals[terminal].top_row = 0;
+    if (terminal == current_terminal_run)
+    {
+        video_mem = terminal_screen(terminal);
+    }
+    if (terminal == current_terminal_view)
+    {
+        scrollback_offset = 0;
+        set_display_start((uint32_t)terminal_screen(terminal));
+    }
+}
+
+/* void scrollback_page(int32_t direction);
+ * Inputs: int32_t direction = 1 to page back, -1 to page forward
+ * Return Value: none
+ * Function: Pages the viewed terminal through its scrollback. The rows shown are drawn in a spare
+ *           page of video memory, so the live screen keeps taking output underneath */
+void scrollback_page(int32_t direction)
+{
+    int32_t terminal = current_terminal_view;
+    uint16_t *page = (uint16_t *)SCROLLBACK_VIDEO;
+    uint16_t *row;
+    int32_t i, y, kept;
+
+    // Only as far back as the rows the scrollback still holds
+    kept = (terminals[terminal].scrollback_rows < SCROLLBACK_ROWS) ? (int32_t)terminals[terminal].scrollback_rows : SCROLLBACK_ROWS;
+    scrollback_offset += direction * NUM_ROWS;
+    if (scrollback_offset > kept)
+    {
+        scrollback_offset = kept;
+    }
+    // Paging forward past the live screen stays on it
+    if (scrollback_offset <= 0)
+    {
+        scrollback_offset = 0;
+        set_display_start((uint32_t)terminal_screen(terminal));
+        update_cursor(terminals[terminal].screen_x, terminals[terminal].screen_y);
+        return;
+    }
+    for (i = 0; i < NUM_ROWS; i++)
+    {
+        if (i < scrollback_offset)
+        {
+            row = scrollback_row(terminal, scrollback_offset - i);
+        }
+        else
+        {
+            row = (uint16_t *)terminal_screen(terminal) + NUM_COLS * (i - scrollback_offset);
+        }
+        memcpy(page + NUM_COLS * i, row, NUM_COLS << 1);
+    }
+    set_display_start(SCROLLBACK_VIDEO);
+    // The cursor moves down with its row, and off the page once that row is not shown
+    y = terminals[terminal].screen_y + scrollback_offset;
+    update_cursor(terminals[terminal].screen_x, (y < NUM_ROWS) ? y : NUM_ROWS);
+}
+
+/* void scrollback_reset(void);
+ * Inputs: none
+ * Return Value: none
+ * Function: Shows the viewed terminal's live screen again if it is scrolled back */
+void scrollback_reset(void)
+{
+    if (scrollback_offset == 0)
+    {
+        return;
+    }
+    scrollback_offset = 0;
+    set_display_start((uint32_t)terminal_screen(current_terminal_view));
+    update_cursor(terminals[current_terminal_view].screen_x, terminals[current_terminal_view].screen_y);
+}
+
 /* void vert_scroll(void);
    Inputs: None
    Outputs: None
-   Function: Shifts everything from row 1 to row 24 up to row 0 to row 23 and clears row 24
+   Function: Scrolls the running terminal up a row and moves the cursor to the start of row 24
 */
 void vert_scroll(void)
 {
-    // Shift every thing starting from row 1 up
-    memmove((uint8_t *)(video_mem), (uint8_t *)(video_mem + ((NUM_COLS * 1) << 1)), ((NUM_ROWS - 1) * NUM_COLS) << 1);
-    unsigned int i;
+    scroll_terminal(current_terminal_run, 1);
     terminals[current_terminal_run].screen_y -= 1;
     terminals[current_terminal_run].screen_x = 0;
-    // Clear the last row
-    for (i = 0; i < 80; i++)
-    {
-        *(uint8_t *)(video_mem + ((NUM_COLS * terminals[current_terminal_run].screen_y + i) << 1)) = ' ';
-    }
     if (current_terminal_run == current_terminal_view)
     {
         update_cursor(terminals[current_terminal_run].screen_x, terminals[current_terminal_run].screen_y);
@@ -206,20 +377,13 @@ void vert_scroll(void)
 /* void terminal_vert_scroll(void);
    Inputs: None
    Outputs: None
-   Function: Shifts everything from row 1 to row 24 up to row 0 to row 23 and clears row 24
+   Function: Scrolls the viewed terminal up a row and moves the cursor to the start of row 24
 */
 void terminal_vert_scroll(void)
 {
-    // Shift every thing starting from row 1 up
-    memmove((uint8_t *)((char *)VIDEO), (uint8_t *)((char *)VIDEO + ((NUM_COLS * 1) << 1)), ((NUM_ROWS - 1) * NUM_COLS) << 1);
-    unsigned int i;
+    scroll_terminal(current_terminal_view, 1);
     terminals[current_terminal_view].screen_y -= 1;
     terminals[current_terminal_view].screen_x = 0;
-    // Clear the last row
-    for (i = 0; i < 80; i++)
-    {
-        *(uint8_t *)((char *)VIDEO + ((NUM_COLS * terminals[current_terminal_view].screen_y + i) << 1)) = ' ';
-    }
     update_cursor(terminals[current_terminal_view].screen_x, terminals[current_terminal_view].screen_y);
 }
 
@@ -238,6 +402,125 @@ int32_t puts(int8_t *s)
     return index;
 }
 
+/* int32_t putbuf(const uint8_t* buf, int32_t nbytes);
+ *   Inputs: const uint8_t* buf = characters to print
+ *           int32_t nbytes = how many
+ *   Return Value: Number of characters printed (NULs are skipped, as in putc)
+ *   Function: Output a buffer to the running terminal with the same result as a putc
+ *             per byte, but with one scroll for the whole buffer, each run of plain
+ *             characters stored in one pass, and one cursor update at the end */
+int32_t putbuf(const uint8_t *buf, int32_t nbytes)
+{
+    uint16_t *cells, *row;
+    uint16_t blank = ' ' | (ATTRIB << EIGHT);
+    int32_t x = terminals[current_terminal_run].screen_x;
+    int32_t y = terminals[current_terminal_run].screen_y;
+    int32_t count = 0, scroll, i, j, k, run;
+    uint8_t c;
+
+    // First pass: where the cursor ends up, so the screen is scrolled once for the whole buffer
+    for (i = 0; i < nbytes; i++)
+    {
+        c = buf[i];
+        if (c == '\0')
+        {
+            continue;
+        }
+        count++;
+        if (c == '\n' || c == '\r')
+        {
+            y++;
+            x = 0;
+            continue;
+        }
+        // A tab is 4 spaces, each of which can wrap
+        for (k = (c == '\t') ? 4 : 1; k > 0; k--)
+        {
+            if (++x == NUM_COLS)
+            {
+                y++;
+                x = 0;
+            }
+        }
+    }
+    scroll = y - (NUM_ROWS - 1);
+    if (scroll > 0)
+    {
+        scroll_terminal(current_terminal_run, scroll);
+    }
+    else
+    {
+        scroll = 0;
+    }
+    cells = (uint16_t *)video_mem;
+
+    // Second pass: rows are shifted up by scroll, and anything that lands above the top goes to the scrollback
+    x = terminals[current_terminal_run].screen_x;
+    y = terminals[current_terminal_run].screen_y - scroll;
+    for (i = 0; i < nbytes; i++)
+    {
+        c = buf[i];
+        if (c == '\0')
+        {
+            continue;
+        }
+        if (c == '\n' || c == '\r')
+        {
+            y++;
+            x = 0;
+            continue;
+        }
+        if (c == '\t')
+        {
+            for (k = 0; k < 4; k++)
+            {
+                row = (y >= 0) ? cells + NUM_COLS * y : scrollback_row(current_terminal_run, -y);
+                if (row != NULL)
+                {
+                    row[x] = blank;
+                }
+                if (++x == NUM_COLS)
+                {
+                    y++;
+                    x = 0;
+                }
+            }
+            continue;
+        }
+        // Plain characters up to a control character or the end of the row
+        for (run = 1; i + run < nbytes && run < NUM_COLS - x; run++)
+        {
+            c = buf[i + run];
+            if (c == '\0' || c == '\n' || c == '\r' || c == '\t')
+            {
+                break;
+            }
+        }
+        row = (y >= 0) ? cells + NUM_COLS * y : scrollback_row(current_terminal_run, -y);
+        if (row != NULL)
+        {
+            for (j = 0; j < run; j++)
+            {
+                row[x + j] = buf[i + j] | (ATTRIB << EIGHT);
+            }
+        }
+        i += run - 1;
+        x += run;
+        if (x == NUM_COLS)
+        {
+            y++;
+            x = 0;
+        }
+    }
+    terminals[current_terminal_run].screen_x = x;
+    terminals[current_terminal_run].screen_y = y;
+    if (current_terminal_run == current_terminal_view)
+    {
+        update_cursor(x, y);
+    }
+    return count;
+}
+
 /* void putc(uint8_t c);
  * Inputs: uint_8* c = character to print
  * Return Value: void
@@ -360,8 +643,8 @@ void terminal_putc(uint8_t c)
         // If the character is a tab, place 4 spaces
         for (i = 0; i < 4; i++)
         {
-            *(uint8_t *)((char *)VIDEO + ((NUM_COLS * terminals[current_terminal_view].screen_y + terminals[current_terminal_view].screen_x) << 1)) = ' ';
-            *(uint8_t *)((char *)VIDEO + ((NUM_COLS * terminals[current_terminal_view].screen_y + terminals[current_terminal_view].screen_x) << 1) + 1) = ATTRIB;
+            *(uint8_t *)(terminal_screen(current_terminal_view) + ((NUM_COLS * terminals[current_terminal_view].screen_y + terminals[current_terminal_view].screen_x) << 1)) = ' ';
+            *(uint8_t *)(terminal_screen(current_terminal_view) + ((NUM_COLS * terminals[current_terminal_view].screen_y + terminals[current_terminal_view].screen_x) << 1) + 1) = ATTRIB;
             terminals[current_terminal_view].screen_x++;
             // If reach the end of a line, move to next line and reset x coordinate
             if (terminals[current_terminal_view].screen_x == NUM_COLS)
@@ -378,8 +661,8 @@ void terminal_putc(uint8_t c)
     }
     else
     {
-        *(uint8_t *)((char *)VIDEO + ((NUM_COLS * terminals[current_terminal_view].screen_y + terminals[current_terminal_view].screen_x) << 1)) = c;
-        *(uint8_t *)((char *)VIDEO + ((NUM_COLS * terminals[current_terminal_view].screen_y + terminals[current_terminal_view].screen_x) << 1) + 1) = ATTRIB;
+        *(uint8_t *)(terminal_screen(current_terminal_view) + ((NUM_COLS * terminals[current_terminal_view].screen_y + terminals[current_terminal_view].screen_x) << 1)) = c;
+        *(uint8_t *)(terminal_screen(current_terminal_view) + ((NUM_COLS * terminals[current_terminal_view].screen_y + terminals[current_terminal_view].screen_x) << 1) + 1) = ATTRIB;
         terminals[current_terminal_view].screen_x++;
         // If reach the end of a line, move to next line and reset x coordinate
         if (terminals[current_terminal_view].screen_x == NUM_COLS)
@@ -407,8 +690,8 @@ void terminal_putc_backspace(void)
         // Move back 1 character
         terminals[current_terminal_view].screen_x -= 1;
         // Put a space in its place to delete it
-        *(uint8_t *)((char *)VIDEO + ((NUM_COLS * terminals[current_terminal_view].screen_y + terminals[current_terminal_view].screen_x) << 1)) = ' ';
-        *(uint8_t *)((char *)VIDEO + ((NUM_COLS * terminals[current_terminal_view].screen_y + terminals[current_terminal_view].screen_x) << 1) + 1) = ATTRIB;
+        *(uint8_t *)(terminal_screen(current_terminal_view) + ((NUM_COLS * terminals[current_terminal_view].screen_y + terminals[current_terminal_view].screen_x) << 1)) = ' ';
+        *(uint8_t *)(terminal_screen(current_terminal_view) + ((NUM_COLS * terminals[current_terminal_view].screen_y + terminals[current_terminal_view].screen_x) << 1) + 1) = ATTRIB;
     }
     else
     {
@@ -416,12 +699,30 @@ void terminal_putc_backspace(void)
         terminals[current_terminal_view].screen_x = NUM_COLS - 1;
         terminals[current_terminal_view].screen_y -= 1;
         // Put a space in its place to delete it
-        *(uint8_t *)((char *)VIDEO + ((NUM_COLS * terminals[current_terminal_view].screen_y + terminals[current_terminal_view].screen_x) << 1)) = ' ';
-        *(uint8_t *)((char *)VIDEO + ((NUM_COLS * terminals[current_terminal_view].screen_y + terminals[current_terminal_view].screen_x) << 1) + 1) = ATTRIB;
+        *(uint8_t *)(terminal_screen(current_terminal_view) + ((NUM_COLS * terminals[current_terminal_view].screen_y + terminals[current_terminal_view].screen_x) << 1)) = ' ';
+        *(uint8_t *)(terminal_screen(current_terminal_view) + ((NUM_COLS * terminals[current_terminal_view].screen_y + terminals[current_terminal_view].screen_x) << 1) + 1) = ATTRIB;
     }
     update_cursor(terminals[current_terminal_view].screen_x, terminals[current_terminal_view].screen_y);
 }
 
+// Character offset of the page on screen from VIDEO
+static uint16_t display_start = 0;
+
+/* void set_display_start(uint32_t address)
+ * Inputs: uint32_t address = video page to show, within the VGA text window
+ * Outputs: none
+ * Function: Shows another page by moving the CRTC start address; nothing is copied.
+ *           The cursor position is relative to the window, so update_cursor follows it.
+ */
+void set_display_start(uint32_t address)
+{
+    display_start = (address - VIDEO) >> 1;
+    outb(START_ADDRESS_HIGH, CURSOR_PORT);
+    outb((uint8_t)((display_start >> EIGHT) & FULL_BYTE_MASK), CURSOR_DATA);
+    outb(START_ADDRESS_LOW, CURSOR_PORT);
+    outb((uint8_t)(display_start & FULL_BYTE_MASK), CURSOR_DATA);
+}
+
 /* void update_cursor(int x, int y)
  * Inputs: int x, y = coordinates of the cursor
  * Outputs: none
@@ -430,8 +731,8 @@ void terminal_putc_backspace(void)
  */
 void update_cursor(int x, int y)
 {
-    // Calculate the current position of the cursor
-    uint16_t pos = y * NUM_COLS + x;
+    // Calculate the current position of the cursor, within the page on screen
+    uint16_t pos = display_start + y * NUM_COLS + x;
 
     // Calculating cursor offsets
     outb(MASK_LAST_FOUR_BITS, CURSOR_PORT);
@@ -10,6 +10,8 @@
 #define EIGHT 8
 #define MASK_LAST_FOUR_BITS 0xF
 #define MASK_LAST_THREE_BITS 0xE
+#define START_ADDRESS_HIGH 0xC // CRTC register with the high byte of the first character shown
+#define START_ADDRESS_LOW 0xD  // CRTC register with its low byte
 #define VIDEO 0xB8000
 
 #include "types.h"
@@ -18,6 +20,11 @@
 volatile char *video_mem;
 
 int32_t printf(int8_t *format, ...);
+char *terminal_screen(int32_t terminal);
+void scroll_terminal(int32_t terminal, int32_t rows);
+void home_terminal(int32_t terminal);
+void scrollback_page(int32_t direction);
+void scrollback_reset(void);
 void vert_scroll(void);
 void terminal_vert_scroll(void);
 void putc(uint8_t c);
@@ -25,7 +32,9 @@ void terminal_putc(uint8_t c);
 void putc_backspace(void);
 void terminal_putc_backspace(void);
 int32_t puts(int8_t *s);
+int32_t putbuf(const uint8_t *buf, int32_t nbytes);
 void enable_cursor(uint8_t start, uint8_t end);
+void set_display_start(uint32_t address);
 void update_cursor(int x, int y);
 int8_t *itoa(uint32_t value, int8_t *buf, int32_t radix);
 int8_t *strrev(int8_t *s);
@@ -92,6 +101,42 @@ static inline uint32_t inl(port)
     return val;
 }
 
+/* Reads "count" two byte words from "port" into the buffer at "buf";
+ * used to drain a disk sector out of a data port */
+static inline void insw(uint32_t port, void *buf, uint32_t count)
+{
+    asm volatile("cld; rep insw"
+                 : "+D"(buf), "+c"(count)
+                 : "d"(port)
+                 : "memory");
+}
+
+/* Reads the time stamp counter (CPU cycles since reset); used to
+ * measure how long short pieces of kernel code take */
+static inline uint64_t rdtsc(void)
+{
+    uint64_t val;
+    asm volatile("rdtsc"
+                 : "=A"(val));
+    return val;
+}
+
+/* Asks the CPU what it supports; leaf picks the question */
+static inline void cpuid(uint32_t leaf, uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx)
+{
+    asm volatile("cpuid"
+                 : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+                 : "a"(leaf));
+}
+
+/* Writes a model-specific register */
+static inline void wrmsr(uint32_t msr, uint32_t low, uint32_t high)
+{
+    asm volatile("wrmsr"
+                 :
+                 : "c"(msr), "a"(low), "d"(high));
+}
+
 /* Writes a byte to a port */
 #define outb(data, port)                    \
     do                                      \
@@ -116,7 +161,7 @@ static inline uint32_t inl(port)
 #define outl(data, port)                    \
     do                                      \
     {                                       \
-        asm volatile("outl %l1, (%w0)"      \
+        asm volatile("outl %1, (%w0)"       \
                      :                      \
                      : "d"(port), "a"(data) \
                      : "memory", "cc");     \
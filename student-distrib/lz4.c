@@ -0,0 +1,105 @@
+#include "lz4.h"
+#include "lib.h"
+
+/**
+ * @brief Reads the extra bytes of a literal or match length
+ *        (Each 255 byte adds 255 and asks for another byte)
+ *
+ * @param src Position in the compressed data, moved past the length bytes
+ * @param src_end End of the compressed data
+ * @param length Length from the token nibble
+ * @return Full length, -1 if the data ends in the middle of the length
+ */
+static int32_t lz4_read_length(const uint8_t **src, const uint8_t *src_end, uint32_t length)
+{
+	uint8_t byte;
+	if (length != LZ4_RUN_MASK)
+	{
+		return length;
+	}
+	do
+	{
+		if (*src >= src_end)
+		{
+			return -1;
+		}
+		byte = *(*src)++;
+		length += byte;
+	} while (byte == LZ4_LENGTH_EXTEND);
+	return length;
+}
+
+/**
+ * @brief Decompresses one LZ4 block (no frame header)
+ *        Every copy is bounds checked, so a corrupt image cannot write past dst
+ *
+ * @param src Compressed data
+ * @param src_length Bytes of compressed data
+ * @param dst Buffer for the decompressed data
+ * @param dst_capacity Size of dst
+ * @return Number of bytes decompressed, -1 if the data is corrupt or does not fit
+ */
+int32_t lz4_decompress(const uint8_t *src, uint32_t src_length, uint8_t *dst, uint32_t dst_capacity)
+{
+	const uint8_t *src_end = src + src_length;
+	uint8_t *out = dst;
+	uint8_t *out_end = dst + dst_capacity;
+	int32_t length;
+	uint32_t offset;
+
+	while (src < src_end)
+	{
+		uint8_t token = *src++;
+
+		// Literals copied straight from the input
+		length = lz4_read_length(&src, src_end, token >> 4);
+		if (length == -1 || length > src_end - src || length > out_end - out)
+		{
+			return -1;
+		}
+		memcpy(out, src, length);
+		out += length;
+		src += length;
+
+		// The last sequence has literals only
+		if (src == src_end)
+		{
+			break;
+		}
+
+		// Match copied from earlier output
+		if (src_end - src < 2)
+		{
+			return -1;
+		}
+		offset = src[0] | (src[1] << 8);
+		src += 2;
+		if (offset == 0 || offset > out - dst)
+		{
+			return -1;
+		}
+		length = lz4_read_length(&src, src_end, token & LZ4_RUN_MASK);
+		if (length == -1)
+		{
+			return -1;
+		}
+		length += LZ4_MIN_MATCH;
+		if (length > out_end - out)
+		{
+			return -1;
+		}
+		if (offset >= length)
+		{
+			memcpy(out, out - offset, length);
+			out += length;
+			continue;
+		}
+		// A match closer than its length repeats bytes it is still writing, so byte by byte
+		while (length-- > 0)
+		{
+			*out = *(out - offset);
+			out++;
+		}
+	}
+	return out - dst;
+}
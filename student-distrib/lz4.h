@@ -0,0 +1,15 @@
+#ifndef LZ4_H
+#define LZ4_H
+
+#include "types.h"
+
+// Referenced https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+
+#define LZ4_MIN_MATCH 4		  // Shortest match; the token stores length - 4
+#define LZ4_RUN_MASK 0x0F	  // Low nibble of the token (match length) or high nibble (literal length)
+#define LZ4_LENGTH_EXTEND 255 // Length byte that says another length byte follows
+
+/* Decompresses one LZ4 block (no frame header) */
+extern int32_t lz4_decompress(const uint8_t *src, uint32_t src_length, uint8_t *dst, uint32_t dst_capacity);
+
+#endif
@@ -0,0 +1,289 @@
+#include "page_cache.h"
+
+#define PAGE_CACHE_HASH(inode, index) (((inode) * 31 + (index)) % PAGE_CACHE_BUCKETS)
+
+// Page descriptors and the memory they describe (page aligned so a page never needs two DMA regions)
+static cache_page_t page_cache_pages[PAGE_CACHE_PAGES];
+static uint8_t page_cache_data[PAGE_CACHE_PAGES][PAGE_CACHE_PAGE_SIZE] __attribute__((aligned(PAGE_CACHE_PAGE_SIZE)));
+
+// Hash chains of the pages that hold (or are loading) file data
+static cache_page_t *page_cache_hash[PAGE_CACHE_BUCKETS];
+
+// Every page, most recently used first; empty pages go to the back
+static cache_page_t *page_cache_mru;
+static cache_page_t *page_cache_lru;
+
+static page_cache_stats_t page_cache_stats;
+
+// Supplied by the file system: where page "index" of "inode" lives on the disk
+static page_cache_block_fn page_cache_block_of;
+
+/**
+ * @brief Takes a page out of the LRU list
+ *
+ * @param page Page to unlink
+ */
+static void lru_remove(cache_page_t *page)
+{
+	if (page->lru_prev != NULL)
+	{
+		page->lru_prev->lru_next = page->lru_next;
+	}
+	else
+	{
+		page_cache_mru = page->lru_next;
+	}
+	if (page->lru_next != NULL)
+	{
+		page->lru_next->lru_prev = page->lru_prev;
+	}
+	else
+	{
+		page_cache_lru = page->lru_prev;
+	}
+	page->lru_prev = NULL;
+	page->lru_next = NULL;
+}
+
+/**
+ * @brief Puts a page at the most recently used end of the LRU list
+ *
+ * @param page Page to insert (not in the list)
+ */
+static void lru_push_front(cache_page_t *page)
+{
+	page->lru_prev = NULL;
+	page->lru_next = page_cache_mru;
+	if (page_cache_mru != NULL)
+	{
+		page_cache_mru->lru_prev = page;
+	}
+	else
+	{
+		page_cache_lru = page;
+	}
+	page_cache_mru = page;
+}
+
+/**
+ * @brief Puts a page at the least recently used end of the LRU list, so it is reused first
+ *
+ * @param page Page to insert (not in the list)
+ */
+static void lru_push_back(cache_page_t *page)
+{
+	page->lru_next = NULL;
+	page->lru_prev = page_cache_lru;
+	if (page_cache_lru != NULL)
+	{
+		page_cache_lru->lru_next = page;
+	}
+	else
+	{
+		page_cache_mru = page;
+	}
+	page_cache_lru = page;
+}
+
+/**
+ * @brief Takes a page out of its hash chain and marks it empty
+ *
+ * @param page Page holding file data
+ */
+static void page_cache_drop(cache_page_t *page)
+{
+	cache_page_t **link = &page_cache_hash[PAGE_CACHE_HASH(page->inode, page->index)];
+	while (*link != NULL && *link != page)
+	{
+		link = &(*link)->hash_next;
+	}
+	if (*link != NULL)
+	{
+		*link = page->hash_next;
+	}
+	page->hash_next = NULL;
+	page->state = PAGE_EMPTY;
+}
+
+/**
+ * @brief Throws away a page whose disk read failed, so it is the next one reused
+ *
+ * @param page Page that was loading
+ */
+static void page_cache_discard(cache_page_t *page)
+{
+	page_cache_drop(page);
+	lru_remove(page);
+	lru_push_back(page);
+}
+
+/**
+ * @brief Records the outcome of a page's disk read once the request has finished
+ *        (Completion interrupts only touch the request, never the cache lists)
+ *
+ * @param page Page to check
+ */
+static void page_cache_settle(cache_page_t *page)
+{
+	uint32_t request_state = page->request.state;
+	if (page->state != PAGE_LOADING || request_state == ATA_REQUEST_QUEUED || request_state == ATA_REQUEST_RUNNING)
+	{
+		return;
+	}
+	page->request.state = ATA_REQUEST_IDLE;
+	if (request_state == ATA_REQUEST_DONE)
+	{
+		page->state = PAGE_VALID;
+		return;
+	}
+	page_cache_discard(page);
+}
+
+/**
+ * @brief Empties the cache and sets where page contents come from
+ *        (Called when a disk image is mounted)
+ *
+ * @param block_of Maps (inode, page index) to an absolute block number
+ */
+void page_cache_init(page_cache_block_fn block_of)
+{
+	uint32_t i;
+	page_cache_block_of = block_of;
+	page_cache_mru = NULL;
+	page_cache_lru = NULL;
+	for (i = 0; i < PAGE_CACHE_BUCKETS; i++)
+	{
+		page_cache_hash[i] = NULL;
+	}
+	for (i = 0; i < PAGE_CACHE_PAGES; i++)
+	{
+		page_cache_pages[i].state = PAGE_EMPTY;
+		page_cache_pages[i].data = page_cache_data[i];
+		page_cache_pages[i].request.state = ATA_REQUEST_IDLE;
+		page_cache_pages[i].hash_next = NULL;
+		lru_push_back(&page_cache_pages[i]);
+	}
+	memset(&page_cache_stats, 0, sizeof(page_cache_stats));
+}
+
+/**
+ * @brief Finds a page, starting a disk read for it if it is not cached
+ *        Read-ahead pages are queued and left to load in the background
+ *
+ * @param inode Inode number of file
+ * @param index Page index within the file (offset / 4096)
+ * @param reason PAGE_CACHE_DEMAND or PAGE_CACHE_READAHEAD (only changes the counters)
+ * @return Page (possibly still loading), NULL if the page has no block or nothing can be reclaimed
+ */
+cache_page_t *page_cache_get(uint32_t inode, uint32_t index, uint32_t reason)
+{
+	cache_page_t *page;
+	uint32_t block;
+
+	for (page = page_cache_hash[PAGE_CACHE_HASH(inode, index)]; page != NULL; page = page->hash_next)
+	{
+		if (page->inode == inode && page->index == index)
+		{
+			break;
+		}
+	}
+	if (page != NULL)
+	{
+		page_cache_settle(page);
+	}
+	if (page != NULL && page->state != PAGE_EMPTY)
+	{
+		lru_remove(page);
+		lru_push_front(page);
+		if (reason == PAGE_CACHE_DEMAND)
+		{
+			page_cache_stats.hits++;
+		}
+		return page;
+	}
+
+	block = page_cache_block_of(inode, index);
+	if (block == 0)
+	{
+		return NULL;
+	}
+	// Reclaim the least recently used page that is not waiting on the disk
+	for (page = page_cache_lru; page != NULL; page = page->lru_prev)
+	{
+		page_cache_settle(page);
+		if (page->state != PAGE_LOADING)
+		{
+			break;
+		}
+	}
+	if (page == NULL)
+	{
+		return NULL;
+	}
+	if (page->state == PAGE_VALID)
+	{
+		page_cache_drop(page);
+		page_cache_stats.evictions++;
+	}
+
+	page->inode = inode;
+	page->index = index;
+	page->request.lba = block * PAGE_CACHE_SECTORS;
+	page->request.count = PAGE_CACHE_SECTORS;
+	page->request.buf = page->data;
+	if (ata_submit(&page->request) == -1)
+	{
+		return NULL;
+	}
+	page->state = PAGE_LOADING;
+	page->hash_next = page_cache_hash[PAGE_CACHE_HASH(inode, index)];
+	page_cache_hash[PAGE_CACHE_HASH(inode, index)] = page;
+	lru_remove(page);
+	lru_push_front(page);
+	if (reason == PAGE_CACHE_DEMAND)
+	{
+		page_cache_stats.misses++;
+	}
+	else
+	{
+		page_cache_stats.readaheads++;
+	}
+	return page;
+}
+
+/**
+ * @brief Waits for a page to be read and returns its data
+ *
+ * @param page Page from page_cache_get
+ * @return Page data, NULL if the disk read failed
+ */
+uint8_t *page_cache_wait(cache_page_t *page)
+{
+	if (page->state == PAGE_LOADING)
+	{
+		if (ata_wait_request(&page->request) == -1)
+		{
+			page_cache_discard(page);
+			return NULL;
+		}
+		page->state = PAGE_VALID;
+	}
+	if (page->state == PAGE_VALID)
+	{
+		return page->data;
+	}
+	return NULL;
+}
+
+/**
+ * @brief Copies the cache counters
+ *
+ * @param stats Destination
+ */
+void page_cache_get_stats(page_cache_stats_t *stats)
+{
+	if (stats != NULL)
+	{
+		memcpy(stats, &page_cache_stats, sizeof(page_cache_stats));
+	}
+}
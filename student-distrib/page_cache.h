@@ -0,0 +1,59 @@
+#ifndef PAGE_CACHE_H
+#define PAGE_CACHE_H
+
+#include "types.h"
+#include "lib.h"
+#include "ata.h"
+
+#define PAGE_CACHE_PAGES 64	  // 256KB of file data kept in memory
+#define PAGE_CACHE_BUCKETS 64 // Hash chains for (inode, page index) lookups
+#define PAGE_CACHE_PAGE_SIZE 4096
+#define PAGE_CACHE_SECTORS (PAGE_CACHE_PAGE_SIZE / ATA_SECTOR_SIZE)
+
+// State of a cached page
+#define PAGE_EMPTY 0
+#define PAGE_LOADING 1 // Disk request in flight
+#define PAGE_VALID 2
+
+// Why a page is being asked for
+#define PAGE_CACHE_DEMAND 0	   // A read needs it now
+#define PAGE_CACHE_READAHEAD 1 // A sequential reader will probably need it soon
+
+/* One page of a file */
+typedef struct cache_page
+{
+	uint32_t inode;
+	uint32_t index;
+	uint32_t state;
+	uint8_t *data;
+	ata_request_t request;
+	struct cache_page *hash_next;
+	struct cache_page *lru_prev; // Towards the most recently used page
+	struct cache_page *lru_next; // Towards the least recently used page
+} cache_page_t;
+
+/* Counters for how well the cache is doing */
+typedef struct page_cache_stats
+{
+	uint32_t hits;		 // Demand lookups found in the cache (or already being read ahead)
+	uint32_t misses;	 // Demand lookups that had to go to the disk
+	uint32_t readaheads; // Pages read ahead of a sequential reader
+	uint32_t evictions;	 // Pages reclaimed to make room
+} page_cache_stats_t;
+
+/* Maps page "index" of "inode" to an absolute block number (0 if there is none) */
+typedef uint32_t (*page_cache_block_fn)(uint32_t inode, uint32_t index);
+
+/* Empties the cache and sets where page contents come from */
+extern void page_cache_init(page_cache_block_fn block_of);
+
+/* Finds a page, starting a disk read for it if it is not cached */
+extern cache_page_t *page_cache_get(uint32_t inode, uint32_t index, uint32_t reason);
+
+/* Waits for a page to be read and returns its data */
+extern uint8_t *page_cache_wait(cache_page_t *page);
+
+/* Copies the cache counters */
+extern void page_cache_get_stats(page_cache_stats_t *stats);
+
+#endif
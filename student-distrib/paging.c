@@ -29,13 +29,12 @@ void page_init(void)
     page_table[VIDEO_12].present = 1;
     page_table[VIDEO_12].bits_31_12 = VIDEO_12;
 
-    // Initialize terminal video memory backup
-    page_table[TERMINAL_0_VIDEO_12].present = 1;
-    page_table[TERMINAL_0_VIDEO_12].bits_31_12 = TERMINAL_0_VIDEO_12;
-    page_table[TERMINAL_1_VIDEO_12].present = 1;
-    page_table[TERMINAL_1_VIDEO_12].bits_31_12 = TERMINAL_1_VIDEO_12;
-    page_table[TERMINAL_2_VIDEO_12].present = 1;
-    page_table[TERMINAL_2_VIDEO_12].bits_31_12 = TERMINAL_2_VIDEO_12;
+    // Initialize the terminal video regions and the scrollback page, the rest of the VGA text window
+    for (pte = VIDEO_12; pte < VIDEO_WINDOW_END_12; pte++)
+    {
+        page_table[pte].present = 1;
+        page_table[pte].bits_31_12 = pte;
+    }
 
     // Set rest of page directory as not present and as mapping to 4 MiB tables
     for (pde = 2; pde < PAGE_DIRECTORY_SIZE; pde++)
@@ -92,7 +91,7 @@ void page_init(void)
     temp_kernel.bits_31_22 = 1;
     page_directory[1] = temp_kernel.val;
 
-    // Stores the address of each terminal buffer; used in scheduling
+    // Stores the address of each terminal's video page; used in scheduling and switching
     terminal_address[0] = TERMINAL_0_VIDEO;
     terminal_address[1] = TERMINAL_1_VIDEO;
     terminal_address[2] = TERMINAL_2_VIDEO;
@@ -116,7 +115,7 @@ uint32_t test_page_structure(void)
     for (pte = 0; pte < PAGE_TABLE_SIZE; pte++)
     {
         // If not video memory, should be not present
-        if (pte != VIDEO_12 && pte != TERMINAL_0_VIDEO_12 && pte != TERMINAL_1_VIDEO_12 && pte != TERMINAL_2_VIDEO_12)
+        if (pte < VIDEO_12 || pte >= VIDEO_WINDOW_END_12)
         {
             if (page_table[pte].present != 0)
             {
@@ -14,18 +14,20 @@
 #define PAGE_TABLE_SIZE 1024       // Size of page table (4 MiB / 4 KiB)
 #define FOUR_KB_BOUNDARIES 4096    // Pages need to be aligned on 4 KiB boundaries
 
-// Backup video memory for the terminals
-#define TERMINAL_0_VIDEO 0xB9000 // VIDEO + 4KB
-#define TERMINAL_1_VIDEO 0xBA000 // VIDEO + 8KB
-#define TERMINAL_2_VIDEO 0xBB000 // VIDEO + 12KB
-#define TERMINAL_0_VIDEO_12 TERMINAL_0_VIDEO >> TWELVE
-#define TERMINAL_1_VIDEO_12 TERMINAL_1_VIDEO >> TWELVE
-#define TERMINAL_2_VIDEO_12 TERMINAL_2_VIDEO >> TWELVE
+// Video memory for the terminals; each owns a region of the VGA text window larger than
+// the screen, and the screen on display is picked with the CRTC start address
+#define TERMINAL_VIDEO_SIZE 0x2000 // 8KB; the screen scrolls down the region before it wraps
+#define TERMINAL_0_VIDEO VIDEO     // The region shown at boot
+#define TERMINAL_1_VIDEO 0xBA000   // VIDEO + 8KB
+#define TERMINAL_2_VIDEO 0xBC000   // VIDEO + 16KB
+#define SCROLLBACK_VIDEO 0xBE000   // VIDEO + 24KB; the viewed terminal's scrollback is drawn here
+#define VIDEO_WINDOW_END 0xC0000   // End of the VGA text window
+#define VIDEO_WINDOW_END_12 VIDEO_WINDOW_END >> TWELVE
 
 /* Number of terminals */
 #define NUM_TERMINALS 3
 
-// Backup video memory addresses for each terminal
+// Video memory address of each terminal
 uint32_t terminal_address[NUM_TERMINALS];
 
 /* A 4 KiB page directory entry (goes into the 0th index of the page directory) */
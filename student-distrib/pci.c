@@ -0,0 +1,69 @@
+#include "pci.h"
+
+/**
+ * @brief Reads a dword of a function's configuration space
+ *
+ * @param location Bus, device and function from PCI_LOCATION
+ * @param offset Register offset (dword aligned)
+ * @return Value of the register
+ */
+uint32_t pci_config_read(uint32_t location, uint32_t offset)
+{
+    outl(PCI_CONFIG_ENABLE | location | (offset & 0xFC), PCI_CONFIG_ADDRESS_PORT);
+    return inl(PCI_CONFIG_DATA_PORT);
+}
+
+/**
+ * @brief Writes a dword of a function's configuration space
+ *
+ * @param location Bus, device and function from PCI_LOCATION
+ * @param offset Register offset (dword aligned)
+ * @param value Value to write
+ */
+void pci_config_write(uint32_t location, uint32_t offset, uint32_t value)
+{
+    outl(PCI_CONFIG_ENABLE | location | (offset & 0xFC), PCI_CONFIG_ADDRESS_PORT);
+    outl(value, PCI_CONFIG_DATA_PORT);
+}
+
+/**
+ * @brief Finds the first function with the given class and subclass
+ *        Scans every bus and device, looking past function 0 only on multifunction devices
+ *
+ * @param class_code Class code (e.g. 0x01 for mass storage)
+ * @param subclass Subclass (e.g. 0x01 for IDE)
+ * @return Location of the function, PCI_NONE if there is no such function
+ */
+uint32_t pci_find_class(uint32_t class_code, uint32_t subclass)
+{
+    uint32_t bus, device, function, location, class_reg;
+    for (bus = 0; bus < PCI_MAX_BUS; bus++)
+    {
+        for (device = 0; device < PCI_MAX_DEVICE; device++)
+        {
+            for (function = 0; function < PCI_MAX_FUNCTION; function++)
+            {
+                location = PCI_LOCATION(bus, device, function);
+                if ((pci_config_read(location, PCI_VENDOR_OFFSET) & 0xFFFF) == PCI_NO_VENDOR)
+                {
+                    // Nothing past an empty function 0
+                    if (function == 0)
+                    {
+                        break;
+                    }
+                    continue;
+                }
+                class_reg = pci_config_read(location, PCI_CLASS_OFFSET);
+                if ((class_reg >> 24) == class_code && ((class_reg >> 16) & 0xFF) == subclass)
+                {
+                    return location;
+                }
+                if (function == 0 && !(pci_config_read(location, PCI_HEADER_OFFSET) & PCI_MULTIFUNCTION))
+                {
+                    break;
+                }
+            }
+        }
+    }
+    return PCI_NONE;
+}
@@ -0,0 +1,44 @@
+#ifndef PCI_H
+#define PCI_H
+
+#include "types.h"
+#include "lib.h"
+
+// Referenced https://wiki.osdev.org/PCI
+
+#define PCI_CONFIG_ADDRESS_PORT 0xCF8
+#define PCI_CONFIG_DATA_PORT 0xCFC
+#define PCI_CONFIG_ENABLE 0x80000000 // Bit 31 of the address turns on the config cycle
+
+#define PCI_MAX_BUS 256
+#define PCI_MAX_DEVICE 32
+#define PCI_MAX_FUNCTION 8
+
+// Configuration space offsets
+#define PCI_VENDOR_OFFSET 0x00	// Vendor (low 16 bits) and device (high 16 bits)
+#define PCI_COMMAND_OFFSET 0x04 // Command (low 16 bits) and status (high 16 bits)
+#define PCI_CLASS_OFFSET 0x08	// Revision, prog-if, subclass and class (high byte)
+#define PCI_HEADER_OFFSET 0x0C	// Header type is byte 2
+#define PCI_BAR4_OFFSET 0x20
+
+#define PCI_NO_VENDOR 0xFFFF		// Vendor read back from an empty slot
+#define PCI_MULTIFUNCTION 0x800000	// Header type bit 7 (in the dword at 0x0C)
+#define PCI_COMMAND_IO 0x01			// Respond to I/O space accesses
+#define PCI_COMMAND_BUS_MASTER 0x04 // Allow the device to start DMA
+#define PCI_BAR_IO 0x01				// Bit 0 of a BAR is set for I/O space
+#define PCI_BAR_IO_MASK 0xFFFFFFFC	// Address bits of an I/O BAR
+
+// Bus, device and function packed the way the config address wants them
+#define PCI_LOCATION(bus, device, function) (((bus) << 16) | ((device) << 11) | ((function) << 8))
+#define PCI_NONE 0xFFFFFFFF
+
+/* Reads a dword of a function's configuration space */
+extern uint32_t pci_config_read(uint32_t location, uint32_t offset);
+
+/* Writes a dword of a function's configuration space */
+extern void pci_config_write(uint32_t location, uint32_t offset, uint32_t value);
+
+/* Finds the first function with the given class and subclass */
+extern uint32_t pci_find_class(uint32_t class_code, uint32_t subclass);
+
+#endif
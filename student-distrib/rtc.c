@@ -1,7 +1,146 @@
 #include "rtc.h"
+#include "vfs.h"
+#include "scheduling.h"
 
 // Referenced https://wiki.osdev.org/RTC
 
+static uint32_t rtc_poll(int32_t fd, wait_queue_t **queue);
+
+// Woken on every RTC interrupt, for poll
+static wait_queue_t rtc_wait;
+
+// Rate the hardware runs at, the fastest any open file asked for; 0 while IRQ8 is masked
+static uint32_t rtc_hardware_frequency = 0;
+
+// Time in 1/FREQ_UPPER_LIMIT s units, and how much each interrupt at the current rate adds
+static volatile uint32_t rtc_time = 0;
+static uint32_t rtc_time_step = 0;
+
+// Open files at each rate, indexed by log2 of the frequency
+static uint32_t rtc_rate_users[RATE_LEVELS];
+
+// Wall clock read from the CMOS at boot, and the PIT tick count at that moment
+static uint32_t wall_clock_base;
+static uint32_t wall_clock_base_tick;
+
+/**
+ * @brief Reads one CMOS register with NMI left disabled for the access
+ *
+ * @param reg Register offset
+ * @return Its value
+ */
+static uint8_t cmos_read(uint8_t reg)
+{
+    uint8_t value;
+    outb(NMI_OFF | reg, RTC_INDEX_PORT);
+    value = inb(RTC_RW_PORT);
+    outb(NMI_ON & reg, RTC_INDEX_PORT);
+    return value;
+}
+
+/**
+ * @brief Reads the time registers once no update is running, until two reads agree
+ *            (an update can still start between the check and the reads)
+ *
+ * @param fields Seconds, minutes, hours, day, month and year as the CMOS stores them
+ */
+static void cmos_read_time(uint8_t *fields)
+{
+    static const uint8_t regs[CMOS_FIELDS] = {CMOS_SECONDS, CMOS_MINUTES, CMOS_HOURS, CMOS_DAY, CMOS_MONTH, CMOS_YEAR};
+    uint8_t last[CMOS_FIELDS];
+    int i, same;
+    do
+    {
+        while (cmos_read(REG_A_OFFSET) & REG_A_UPDATING)
+        {
+        }
+        for (i = 0; i < CMOS_FIELDS; i++)
+        {
+            last[i] = cmos_read(regs[i]);
+        }
+        while (cmos_read(REG_A_OFFSET) & REG_A_UPDATING)
+        {
+        }
+        same = 1;
+        for (i = 0; i < CMOS_FIELDS; i++)
+        {
+            fields[i] = cmos_read(regs[i]);
+            same &= (fields[i] == last[i]);
+        }
+    } while (!same);
+}
+
+/**
+ * @brief Reads the CMOS time once and keeps it as seconds since the epoch
+ *
+ * @note  Afterwards the time comes from the PIT tick count, so wall_clock_now never touches the
+ *        slow CMOS ports and the RTC interrupt can stay masked while nothing has "rtc" open
+ * @note  The CMOS time is taken to be UTC, as QEMU sets it
+ */
+static void wall_clock_init(void)
+{
+    static const uint16_t days_before_month[] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+    uint8_t fields[CMOS_FIELDS];
+    uint8_t format = cmos_read(REG_B_OFFSET);
+    uint32_t second, minute, hour, day, month, year, days;
+    int pm, i;
+
+    cmos_read_time(fields);
+    pm = !(format & REG_B_24HOUR) && (fields[2] & HOUR_PM);
+    fields[2] &= ~HOUR_PM;
+    if (!(format & REG_B_BINARY))
+    {
+        for (i = 0; i < CMOS_FIELDS; i++)
+        {
+            fields[i] = (fields[i] >> 4) * 10 + (fields[i] & 0x0F);
+        }
+    }
+    second = fields[0];
+    minute = fields[1];
+    hour = fields[2];
+    day = fields[3];
+    month = fields[4];
+    year = fields[5] + ((fields[5] < CMOS_CENTURY_SPLIT) ? 2000 : 1900);
+    // 12 AM is hour 0 and 12 PM is hour 12
+    if (!(format & REG_B_24HOUR))
+    {
+        hour = (hour % 12) + (pm ? 12 : 0);
+    }
+    if (month < 1 || month > 12)
+    {
+        month = 1;
+    }
+
+    // Whole years since 1970, counting a leap day for every leap year passed
+    days = (year - 1970) * 365 + (year - 1969) / 4 - (year - 1901) / 100 + (year - 1601) / 400;
+    days += days_before_month[month - 1] + day - 1;
+    if (month > 2 && (year % 4 == 0 && (year % 100 != 0 || year % 400 == 0)))
+    {
+        days++;
+    }
+    wall_clock_base = days * SECONDS_PER_DAY + hour * SECONDS_PER_HOUR + minute * SECONDS_PER_MINUTE + second;
+    wall_clock_base_tick = pit_wait.wakeups;
+}
+
+/**
+ * @brief Gives the current time from the cached copy
+ *
+ * @return Seconds since 1970-01-01 00:00 UTC
+ */
+uint32_t wall_clock_now(void)
+{
+    return wall_clock_base + (pit_wait.wakeups - wall_clock_base_tick) / PIT_HZ;
+}
+
+static const file_operations_table_t rtc_table = {
+    .open = rtc_open,
+    .close = rtc_close,
+    .read = rtc_read,
+    .write = rtc_write,
+    .fstat = vfs_device_fstat,
+    .poll = rtc_poll,
+};
+
 /**
  * @brief Initializes the RTC to enable periodic interrupts (IRQ 8)
  *
@@ -10,7 +149,9 @@
  *
  * @note  IRQ handler must be present in IDT table before calling this
  *            since the interrupt will happen immediately
- * @note  Will switch on IRQ with default 1024 Hz rate
+ * @note  Turns on periodic interrupts, but IRQ8 is left masked until "rtc" is opened
+ * @note  Attaches the RTC as the "rtc" device
+ * @note  Reads the wall clock time
  */
 void rtc_init(void)
 {
@@ -26,8 +167,11 @@ void rtc_init(void)
     outb(prev_val | ENABLE_IRQ8, RTC_RW_PORT);
     // Enable NMI
     outb(NMI_ON & REG_B_OFFSET, RTC_INDEX_PORT);
-    // Enable interrupts for IRQ8 on PIC
-    enable_irq(RTC_IRQ);
+    // IRQ8 is unmasked on the PIC by rtc_update_rate once someone opens the device
+    // Read the time of day while interrupts are still off; it is cached from here on
+    wall_clock_init();
+    // The "rtc" entry in the filesystem opens through this table
+    vfs_register_device((int8_t *)"rtc", &rtc_table);
 }
 
 /**
@@ -37,11 +181,12 @@ void rtc_init(void)
  *  Output: none
  *
  * @note  If register C is not read, another interrupt will not occur
+ * @note  Only advances the clock; each open file compares it with its own deadline
  */
 void rtc_handler(void)
 {
-    // interrupt_occurred = true;
-    terminals[current_terminal_run].interrupt_count++;
+    rtc_time += rtc_time_step;
+    wait_queue_wake(&rtc_wait);
     // Select register C
     outb(REG_C_OFFSET, RTC_INDEX_PORT);
     // Read the current value in register C
@@ -52,8 +197,83 @@ void rtc_handler(void)
     send_eoi(RTC_IRQ);
 }
 
-// open, write, loop read until interrupt count == factor, then set interrupt count = 0
-// share count, factor for virtualisation
+// Every open file is its own virtual RTC: a period and the time of its next tick,
+// both in 1/FREQ_UPPER_LIMIT s, kept in the open file and shared by its dups
+
+/**
+ * @brief Programs the hardware for the fastest rate any open file asked for
+ *
+ *  Input: none
+ *  Output: none
+ *
+ * @note  Masks IRQ8 when nothing has the device open, so an idle RTC costs no interrupts
+ */
+static void rtc_update_rate(void)
+{
+    uint32_t flags;
+    uint32_t fastest = 0;
+    int i;
+    cli_and_save(flags);
+    for (i = RATE_LEVELS - 1; i >= 0; i--)
+    {
+        if (rtc_rate_users[i] > 0)
+        {
+            fastest = 1 << i;
+            break;
+        }
+    }
+    if (fastest == 0)
+    {
+        if (rtc_hardware_frequency != 0)
+        {
+            disable_irq(RTC_IRQ);
+            rtc_hardware_frequency = 0;
+        }
+        restore_flags(flags);
+        return;
+    }
+    if (fastest != rtc_hardware_frequency)
+    {
+        // Select register A and disable NMI, then keep its top half and replace the rate
+        outb(NMI_OFF | REG_A_OFFSET, RTC_INDEX_PORT);
+        char prev_val = inb(RTC_RW_PORT);
+        outb(NMI_OFF | REG_A_OFFSET, RTC_INDEX_PORT);
+        outb((prev_val & ~RATE_MASK) | (RATE_BASE_SHIFT - __builtin_ctz(fastest)), RTC_RW_PORT);
+        outb(NMI_ON & REG_A_OFFSET, RTC_INDEX_PORT);
+        rtc_time_step = FREQ_UPPER_LIMIT / fastest;
+        if (rtc_hardware_frequency == 0)
+        {
+            // Clear a flag left from before the mask, or no further interrupt would come
+            outb(REG_C_OFFSET, RTC_INDEX_PORT);
+            inb(RTC_RW_PORT);
+            enable_irq(RTC_IRQ);
+        }
+        rtc_hardware_frequency = fastest;
+    }
+    restore_flags(flags);
+}
+
+/**
+ * @brief Finds the virtual RTC of an open file, starting it at 2 Hz on first use
+ *
+ * @param fd File descriptor
+ * @return The open file, 0 if fd is not open
+ */
+static file_descriptor_t *rtc_file(int32_t fd)
+{
+    file_descriptor_t *file = find_pcb(fd);
+    if (file == 0)
+    {
+        return 0;
+    }
+    // open is not told the fd, so a new file has a period of 0 until it is first used
+    if (file->rtc_period == 0)
+    {
+        file->rtc_period = PERIOD_INIT;
+        file->rtc_deadline = rtc_time + PERIOD_INIT;
+    }
+    return file;
+}
 
 /**
  * @brief  Initialises RTC frequency to 2 Hz
@@ -65,47 +285,61 @@ void rtc_handler(void)
  */
 int32_t rtc_open(const uint8_t *filename)
 {
-    // 2 Hz * ?? = 1024 Hz
-    terminals[current_terminal_run].factor = FACTOR_INIT;
-    // Set count to 0 for first batch of interrupts
-    terminals[current_terminal_run].interrupt_count = 0;
+    rtc_rate_users[__builtin_ctz(FREQ_INIT)]++;
+    // Starts the hardware if this is the first opener
+    rtc_update_rate();
 
     return 0;
 }
 
 /**
- * @brief  Unset global variables that were set for virtualisation
+ * @brief  Gives up the open file's rate
  *
  *  Input: fd
  *  Output: 0
  *
+ * @note   Called once the last descriptor referring to the open file is closed
  * @return 0 upon success
  */
 int32_t rtc_close(int32_t fd)
 {
-    terminals[current_terminal_run].factor = 0;
-    terminals[current_terminal_run].interrupt_count = 0;
+    file_descriptor_t *file = rtc_file(fd);
+    uint32_t level = __builtin_ctz(file ? FREQ_UPPER_LIMIT / file->rtc_period : FREQ_INIT);
+    if (rtc_rate_users[level] > 0)
+    {
+        rtc_rate_users[level]--;
+    }
+    // The hardware may slow down, or stop if this was the last opener
+    rtc_update_rate();
     return 0;
 }
 
 /**
- * @brief  Blocks until the next interrupt
+ * @brief  Blocks until the open file's next virtual tick
  *
  *  Input: fd, buf, nbytes
- *  Output: 0
+ *  Output: number of ticks missed, -1
  *
- * @return 0 when the next interrupt has occurred
+ * @return 0 when the read came in time for the tick, else how many ticks went by
+ *         before it (a caller can drop that many frames), -1 if fd is not open
  */
 int32_t rtc_read(int32_t fd, void *buf, int32_t nbytes)
 {
-    // Wait until handler has been called an appropriate number of times
-    while (terminals[current_terminal_run].interrupt_count < terminals[current_terminal_run].factor)
+    file_descriptor_t *file = rtc_file(fd);
+    uint32_t missed;
+    if (file == 0)
     {
+        return -1;
     }
-    // Reset count for next batch of interrupts
-    terminals[current_terminal_run].interrupt_count = 0;
+    // Wait until the clock reaches the deadline (signed, so it survives wrapping)
+    while ((int32_t)(rtc_time - file->rtc_deadline) < 0)
+    {
+    }
+    // Skip the ticks that went by, so a late reader does not fall further behind
+    missed = (rtc_time - file->rtc_deadline) / file->rtc_period;
+    file->rtc_deadline += (missed + 1) * file->rtc_period;
 
-    return 0;
+    return missed;
 }
 
 /**
@@ -122,13 +356,49 @@ int32_t rtc_write(int32_t fd, const void *buf, int32_t nbytes)
     // Acquire frequency of program by dereferencing buf
     uint32_t *buf_int32 = (uint32_t *)buf;
     uint32_t frequency = *buf_int32;
+    file_descriptor_t *file;
+    uint32_t level;
 
     // Return -1 if frequency is not a power of 2 or out of range [2, 1024]
     if ((frequency & (~(frequency - 1))) != frequency || frequency < FREQ_LOWER_LIMIT || frequency > FREQ_UPPER_LIMIT)
         return -1;
 
-    // frequency * ?? = 1024 Hz
-    terminals[current_terminal_run].factor = FREQ_UPPER_LIMIT / frequency;
+    file = rtc_file(fd);
+    if (file == 0)
+        return -1;
+
+    // Move this file's count to the new rate
+    level = __builtin_ctz(FREQ_UPPER_LIMIT / file->rtc_period);
+    if (rtc_rate_users[level] > 0)
+    {
+        rtc_rate_users[level]--;
+    }
+    rtc_rate_users[__builtin_ctz(frequency)]++;
+    // frequency * period = 1024 Hz; the next tick is a whole new period away
+    file->rtc_period = FREQ_UPPER_LIMIT / frequency;
+    file->rtc_deadline = rtc_time + file->rtc_period;
+    // Speeds the hardware up if this is now the fastest
+    rtc_update_rate();
 
     return 0;
 }
+
+/**
+ * @brief     Tells poll whether rtc_read would return without waiting
+ *
+ *  Input: fd, queue
+ *  Output: POLLIN | POLLOUT, POLLOUT
+ *
+ * @param queue Set to the queue woken on every RTC interrupt
+ * @return    POLLOUT always (the rate can be changed), with POLLIN once the next virtual tick is due
+ */
+static uint32_t rtc_poll(int32_t fd, wait_queue_t **queue)
+{
+    file_descriptor_t *file = rtc_file(fd);
+    *queue = &rtc_wait;
+    if (file != 0 && (int32_t)(rtc_time - file->rtc_deadline) >= 0)
+    {
+        return POLLIN | POLLOUT;
+    }
+    return POLLOUT;
+}
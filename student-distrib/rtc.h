@@ -11,28 +11,52 @@
 #define RTC_RW_PORT 0x71    // Used to read or write to that register
 #define NMI_OFF 0x80        // Used to set Bit 7 for disabling non-maskable interrupts
 #define NMI_ON 0x7F         // Used to clear Bit 7 for enabling non-maskable interrupts
+#define REG_A_OFFSET 0x0A   // Offset to get register A in CMOS
 #define REG_B_OFFSET 0x0B   // Offset to get register B in CMOS
 #define REG_C_OFFSET 0x0C   // Offset to get register C in CMOS
 #define ENABLE_IRQ8 0x40    // Used to set bit 6 of register B to turn on periodic interrupt of RTC
+#define RATE_MASK 0x0F      // Low 4 bits of register A select the periodic rate
+#define RATE_BASE_SHIFT 16  // Rate r gives 32768 >> (r - 1) Hz, so 2^n Hz is rate 16 - n
 
 #define FREQ_UPPER_LIMIT 1024                    // Highest valid interrupt frequency in Hz (2^10)
 #define FREQ_LOWER_LIMIT 2                       // Lowest valid interrupt frequency in Hz (2^1)
 #define FREQ_INIT FREQ_LOWER_LIMIT               // Lowest valid interrupt frequency in Hz (2^1)
-#define FACTOR_INIT FREQ_UPPER_LIMIT / FREQ_INIT // Interrupt count for 2 Hz RTC (initialised at rtc_open)
+#define PERIOD_INIT (FREQ_UPPER_LIMIT / FREQ_INIT) // Period of a 2 Hz virtual RTC in 1/1024 s
+#define RATE_LEVELS 11                            // Powers of 2 from 1 Hz to FREQ_UPPER_LIMIT
 
-/* Initializes the RTC to enable periodic interrupts (IRQ 8) */
+// CMOS time of day registers (BCD and 12 hour unless register B says otherwise)
+#define CMOS_SECONDS 0x00
+#define CMOS_MINUTES 0x02
+#define CMOS_HOURS 0x04
+#define CMOS_DAY 0x07
+#define CMOS_MONTH 0x08
+#define CMOS_YEAR 0x09
+#define REG_A_UPDATING 0x80 // Set in register A while the RTC is changing the time registers
+#define REG_B_24HOUR 0x02   // Set in register B if hours run 0-23
+#define REG_B_BINARY 0x04   // Set in register B if values are binary, not BCD
+#define HOUR_PM 0x80        // Set in the hours register for PM in 12 hour mode
+#define CMOS_FIELDS 6
+#define CMOS_CENTURY_SPLIT 70 // Two digit years below this are 20xx (the epoch is 1970)
+#define SECONDS_PER_DAY 86400
+#define SECONDS_PER_HOUR 3600
+#define SECONDS_PER_MINUTE 60
+
+/* Initializes the RTC to enable periodic interrupts (IRQ 8 stays masked until the first open) */
 extern void rtc_init(void);
 
+/* Seconds since 1970-01-01 00:00 UTC, from the copy of the CMOS time read at boot */
+extern uint32_t wall_clock_now(void);
+
 /* Handler called when interrupt occurs */
 extern void rtc_handler(void);
 
 /* Initialises RTC frequency to 2 Hz */
 extern int32_t rtc_open(const uint8_t *filename);
 
-/* Unsets global variables that were set for virtualisation */
+/* Gives up the open file's rate once its last descriptor is closed */
 extern int32_t rtc_close(int32_t fd);
 
-/* Blocks until the next interrupt */
+/* Blocks until the open file's next virtual tick; returns the ticks missed */
 extern int32_t rtc_read(int32_t fd, void *buf, int32_t nbytes);
 
 /* Changes frequency to frequency stored in pointer */
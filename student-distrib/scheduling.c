@@ -3,6 +3,8 @@
 
 #include "scheduling.h"
 
+wait_queue_t pit_wait;
+
 // The data rate is actually a 'divisor' register for this device. The timer
 // will divide it's input clock of 1.19MHz (1193180Hz) by the number you give it in
 // the data register to figure out how many times per second to fire the signal for that channel
@@ -25,6 +27,7 @@ void pit_init(void)
 
 void pit_handler(void)
 {
+    wait_queue_wake(&pit_wait);
     send_eoi(TIMER_IRQ);
     scheduler();
 }
@@ -50,33 +53,19 @@ void scheduler(void)
     current_terminal_run++;
     current_terminal_run = current_terminal_run % NUM_SHELLS;
 
-    // Load video data into video memory directly
-    if (current_terminal_run == current_terminal_view)
-    {
-        video_mem = (char *)VIDEO;
-        // For fish
-        if (page_table2[0].present == 1)
-        {
-            page_table2[0].bits_31_12 = VIDEO_12;
-            flush_TLB();
-        }
-    }
-    else
+    // Every terminal draws in its own video page, whether or not it is on screen
+    video_mem = terminal_screen(current_terminal_run);
+    // For fish
+    if (page_table2[0].present == 1)
     {
-        // Load video data into terminal video buffer
-        video_mem = (char *)terminal_address[current_terminal_run];
-        // For fish
-        if (page_table2[0].present == 1)
-        {
-            page_table2[0].bits_31_12 = terminal_address[current_terminal_run];
-            flush_TLB();
-        }
+        page_table2[0].bits_31_12 = terminal_address[current_terminal_run] >> TWELVE;
+        flush_TLB();
     }
 
     // Base shell not active so execute it
     if (terminals[current_terminal_run].current_pid == -1)
     {
-        video_mem = (char *)terminal_address[current_terminal_run];
+        video_mem = terminal_screen(current_terminal_run);
         execute_base_shell(current_terminal_run);
         return;
     }
@@ -2,6 +2,7 @@
 #define SCHEDULING_H
 
 #include "lib.h"
+#include "vfs.h"
 #include "i8259.h"
 #include "system_call.h"
 
@@ -13,9 +14,13 @@
 #define EIGHT 8
 #define TIMER_IRQ 0
 #define NUM_SHELLS 3
+#define PIT_HZ 100 // Ticks per second (see DIVISOR)
 
 int32_t current_terminal_run;
 
+// Woken on every PIT tick; its wakeups count ticks since pit_init
+extern wait_queue_t pit_wait;
+
 void pit_init(void);
 uint32_t read_pit_count(void);
 void pit_handler(void);
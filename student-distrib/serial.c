@@ -0,0 +1,125 @@
+#include "serial.h"
+#include "lib.h"
+#include "vfs.h"
+#include "scheduling.h"
+
+// Referenced https://wiki.osdev.org/Serial_Ports
+
+/**
+ * @brief Open and close of the serial port, which is set up once at boot
+ *
+ * @return 0
+ */
+static int32_t serial_open(const uint8_t *filename)
+{
+    return 0;
+}
+
+static int32_t serial_close(int32_t fd)
+{
+    return 0;
+}
+
+static uint32_t serial_poll(int32_t fd, wait_queue_t **queue);
+
+static const file_operations_table_t serial_table = {
+    .open = serial_open,
+    .close = serial_close,
+    .read = serial_read,
+    .write = serial_write,
+    .fstat = vfs_device_fstat,
+    .poll = serial_poll,
+};
+
+/**
+ * @brief Sets COM1 to 38400 8N1 with its interrupts off, and attaches it as the "serial" device
+ *
+ * @return 0 upon success, -1 if there is no working port at COM1
+ */
+int32_t serial_init(void)
+{
+    outb(0x00, SERIAL_COM1 + SERIAL_INTERRUPT_ENABLE);
+    outb(SERIAL_LINE_DLAB, SERIAL_COM1 + SERIAL_LINE_CONTROL);
+    outb(SERIAL_DIVISOR, SERIAL_COM1 + SERIAL_DATA);
+    outb(0x00, SERIAL_COM1 + SERIAL_INTERRUPT_ENABLE);
+    outb(SERIAL_LINE_8N1, SERIAL_COM1 + SERIAL_LINE_CONTROL);
+    outb(SERIAL_FIFO_ENABLE, SERIAL_COM1 + SERIAL_FIFO_CONTROL);
+
+    // A port that does not give back the byte it sent to itself is missing or broken
+    outb(SERIAL_MODEM_LOOPBACK, SERIAL_COM1 + SERIAL_MODEM_CONTROL);
+    outb(SERIAL_TEST_BYTE, SERIAL_COM1 + SERIAL_DATA);
+    if (inb(SERIAL_COM1 + SERIAL_DATA) != SERIAL_TEST_BYTE)
+    {
+        return -1;
+    }
+    outb(SERIAL_MODEM_NORMAL, SERIAL_COM1 + SERIAL_MODEM_CONTROL);
+    return vfs_register_device((int8_t *)"serial", &serial_table);
+}
+
+/**
+ * @brief Reads the bytes that have arrived, without waiting for more
+ *
+ *  Input: fd, buf, nbytes
+ *  Output: number of bytes read
+ *
+ * @return Number of bytes read (0 if none are waiting), -1 for fail
+ */
+int32_t serial_read(int32_t fd, void *buf, int32_t nbytes)
+{
+    uint8_t *out = (uint8_t *)buf;
+    int32_t num = 0;
+    if (buf == NULL || nbytes < 0)
+    {
+        return -1;
+    }
+    while (num < nbytes && (inb(SERIAL_COM1 + SERIAL_LINE_STATUS) & SERIAL_STATUS_DATA_READY))
+    {
+        out[num++] = inb(SERIAL_COM1 + SERIAL_DATA);
+    }
+    return num;
+}
+
+/**
+ * @brief Sends bytes, waiting for room in the transmitter before each one
+ *
+ *  Input: fd, buf, nbytes
+ *  Output: number of bytes sent
+ *
+ * @return Number of bytes sent (fewer if the port stops taking them), -1 for fail
+ */
+int32_t serial_write(int32_t fd, const void *buf, int32_t nbytes)
+{
+    const uint8_t *in = (const uint8_t *)buf;
+    int32_t num;
+    uint32_t polls;
+    if (buf == NULL || nbytes < 0)
+    {
+        return -1;
+    }
+    for (num = 0; num < nbytes; num++)
+    {
+        for (polls = 0; !(inb(SERIAL_COM1 + SERIAL_LINE_STATUS) & SERIAL_STATUS_THR_EMPTY); polls++)
+        {
+            if (polls == SERIAL_TIMEOUT)
+            {
+                return num;
+            }
+        }
+        outb(in[num], SERIAL_COM1 + SERIAL_DATA);
+    }
+    return num;
+}
+
+/**
+ * @brief Tells poll what the port could do without waiting
+ *        (Its interrupts are off, so poll checks again every PIT tick)
+ *
+ * @param queue Set to the PIT tick queue
+ * @return POLLIN if a byte has arrived, POLLOUT if one can be sent
+ */
+static uint32_t serial_poll(int32_t fd, wait_queue_t **queue)
+{
+    uint8_t status = inb(SERIAL_COM1 + SERIAL_LINE_STATUS);
+    *queue = &pit_wait;
+    return ((status & SERIAL_STATUS_DATA_READY) ? POLLIN : 0) | ((status & SERIAL_STATUS_THR_EMPTY) ? POLLOUT : 0);
+}
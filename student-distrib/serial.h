@@ -0,0 +1,39 @@
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include "types.h"
+
+// Referenced https://wiki.osdev.org/Serial_Ports
+
+#define SERIAL_COM1 0x3F8 // I/O base of the first serial port
+
+// Register offsets from the I/O base
+#define SERIAL_DATA 0			// Receive/transmit buffer (divisor low byte while DLAB is set)
+#define SERIAL_INTERRUPT_ENABLE 1 // (divisor high byte while DLAB is set)
+#define SERIAL_FIFO_CONTROL 2
+#define SERIAL_LINE_CONTROL 3
+#define SERIAL_MODEM_CONTROL 4
+#define SERIAL_LINE_STATUS 5
+
+#define SERIAL_LINE_DLAB 0x80		 // Line control: next two registers hold the baud divisor
+#define SERIAL_LINE_8N1 0x03		 // Line control: 8 data bits, no parity, one stop bit
+#define SERIAL_FIFO_ENABLE 0xC7		 // Enable and clear the FIFOs, 14 byte threshold
+#define SERIAL_MODEM_LOOPBACK 0x1E	 // Modem control: loopback, for the self test
+#define SERIAL_MODEM_NORMAL 0x0F	 // Modem control: DTR, RTS, OUT1 and OUT2 set
+#define SERIAL_STATUS_DATA_READY 0x01 // Line status: a received byte is waiting
+#define SERIAL_STATUS_THR_EMPTY 0x20  // Line status: a byte can be sent
+
+#define SERIAL_DIVISOR 3		  // 115200 / 3 = 38400 baud
+#define SERIAL_TEST_BYTE 0xAE	  // Sent to itself in loopback to check the port is there
+#define SERIAL_TIMEOUT 100000	  // Status polls before giving up on sending a byte
+
+/* Sets COM1 to 38400 8N1 and attaches it as the "serial" device */
+extern int32_t serial_init(void);
+
+/* Reads the bytes that have arrived, without waiting */
+extern int32_t serial_read(int32_t fd, void *buf, int32_t nbytes);
+
+/* Sends bytes, waiting for room in the transmitter */
+extern int32_t serial_write(int32_t fd, const void *buf, int32_t nbytes);
+
+#endif
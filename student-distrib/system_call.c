@@ -7,11 +7,137 @@ int32_t lowest_free_pid = 3;
 // Number of active processes; base shell counts already
 int8_t num_process = 3;
 
-file_operations_table_t stdin_table;
-file_operations_table_t stdout_table;
-file_operations_table_t rtc_table;
-file_operations_table_t dentry_table;
-file_operations_table_t file_table;
+// System call accounting for each process slot, and for everything since boot
+static syscall_stats_t process_syscall_stats[MAX_PROCESS];
+static syscall_stats_t all_syscall_stats;
+
+// Open files, free while refcount is 0
+static file_descriptor_t open_files[MAX_OPEN_FILES];
+
+// Descriptor tables for processes that outgrow the one in their PCB
+static file_descriptor_t *fd_table_pool[FD_TABLE_POOL][FD_TABLE_MAX];
+static uint8_t fd_table_pool_used[FD_TABLE_POOL];
+
+/* alloc_open_file
+ *
+ *  Input: none
+ *  Output: a cleared open file with one reference, 0 if all are in use
+ *  Description: takes an open file from the shared pool
+ */
+static file_descriptor_t *alloc_open_file(void)
+{
+    uint32_t i;
+    for (i = 0; i < MAX_OPEN_FILES; i++)
+    {
+        if (open_files[i].refcount == 0)
+        {
+            memset(&open_files[i], 0, sizeof(file_descriptor_t));
+            open_files[i].refcount = 1;
+            return &open_files[i];
+        }
+    }
+    return 0;
+}
+
+/* fd_table_grow
+ *
+ *  Input: pcb, number of descriptors needed
+ *  Output: 0 on success, -1 if no bigger table is free or size is too big
+ *  Description: moves a process's descriptors from its PCB to a table from the pool
+ */
+static int32_t fd_table_grow(pcb_t *pcb, uint32_t size)
+{
+    uint32_t i, j;
+    if (size <= pcb->fd_table_size)
+    {
+        return 0;
+    }
+    if (size > FD_TABLE_MAX)
+    {
+        return -1;
+    }
+    for (i = 0; i < FD_TABLE_POOL; i++)
+    {
+        if (fd_table_pool_used[i] == 0)
+        {
+            fd_table_pool_used[i] = 1;
+            for (j = 0; j < FD_TABLE_MAX; j++)
+            {
+                fd_table_pool[i][j] = (j < pcb->fd_table_size) ? pcb->file_descriptor_table[j] : 0;
+            }
+            pcb->file_descriptor_table = fd_table_pool[i];
+            pcb->fd_table_size = FD_TABLE_MAX;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* fd_alloc
+ *
+ *  Input: pcb, lowest descriptor to hand out
+ *  Output: lowest free descriptor at or above lowest, -1 if the table is full and cannot grow
+ *  Description: finds a free slot in a process's descriptor table, growing it if needed
+ */
+static int32_t fd_alloc(pcb_t *pcb, uint32_t lowest)
+{
+    uint32_t i;
+    for (i = lowest; i < pcb->fd_table_size; i++)
+    {
+        if (pcb->file_descriptor_table[i] == 0)
+        {
+            return i;
+        }
+    }
+    if (fd_table_grow(pcb, pcb->fd_table_size + 1) == -1)
+    {
+        return -1;
+    }
+    return i;
+}
+
+/* fd_release
+ *
+ *  Input: pcb, fd
+ *  Output: none
+ *  Description: empties a descriptor slot; the open file is closed and freed with its last reference
+ */
+static void fd_release(pcb_t *pcb, uint32_t fd)
+{
+    file_descriptor_t *file_descriptor_ptr = pcb->file_descriptor_table[fd];
+    if (file_descriptor_ptr != 0 && --file_descriptor_ptr->refcount == 0)
+    {
+        // The device lets go of the open file while fd still leads to it
+        file_descriptor_ptr->file_operations_table_ptr->close(fd);
+        file_descriptor_ptr->file_operations_table_ptr = 0;
+        file_descriptor_ptr->flags = 0;
+    }
+    pcb->file_descriptor_table[fd] = 0;
+}
+
+/* fd_table_free
+ *
+ *  Input: pcb
+ *  Output: none
+ *  Description: releases every descriptor of a process and gives a grown table back to the pool
+ */
+static void fd_table_free(pcb_t *pcb)
+{
+    uint32_t i;
+    for (i = 0; i < pcb->fd_table_size; i++)
+    {
+        fd_release(pcb, i);
+    }
+    for (i = 0; i < FD_TABLE_POOL; i++)
+    {
+        if (pcb->file_descriptor_table == fd_table_pool[i])
+        {
+            fd_table_pool_used[i] = 0;
+        }
+    }
+    pcb->file_descriptor_table = pcb->fd_small;
+    pcb->fd_table_size = FD_TABLE_SIZE;
+}
 
 int32_t halt(uint16_t status)
 {
@@ -19,10 +145,12 @@ int32_t halt(uint16_t status)
     pcb_t *PCB_curr = (pcb_t *)(BOTTOM_KERNEL - (PROCESS_SIZE * (terminals[current_terminal_run].current_pid + 1)));
     int32_t cur_pid_temp = terminals[current_terminal_run].current_pid;
     int32_t parent_pid = PCB_curr->parent_id;
-    uint32_t i;
-    for (i = 0; i < FD_TABLE_SIZE; i++)
+    // stdin and stdout go too; a child only held references to its parent's
+    fd_table_free(PCB_curr);
+    // Scrolling may move the screen down the video region again
+    if (terminals[current_terminal_run].vidmap_pid == cur_pid_temp)
     {
-        close(i);
+        terminals[current_terminal_run].vidmap_pid = -1;
     }
     // Base shell
     if (parent_pid == -1)
@@ -74,19 +202,18 @@ int32_t halt(uint16_t status)
 /* find_pcb
  *
  *  Input: fd
- *  Output: pointer to file_descriptor
- *          0 if pcb is not found
- *  Description: Goes to the pcb corresponding to the current process id and gets the file descriptor at index fd
+ *  Output: pointer to the open file
+ *          0 if fd is out of range or not open
+ *  Description: Goes to the pcb corresponding to the current process id and gets the open file at index fd
  */
-file_descriptor_t *find_pcb(uint8_t fd)
+file_descriptor_t *find_pcb(int32_t fd)
 {
-    if (fd >= 8)
+    pcb_t *mem_ptr = (pcb_t *)(BOTTOM_KERNEL - (PROCESS_SIZE * (terminals[current_terminal_run].current_pid + 1)));
+    if (fd < 0 || fd >= mem_ptr->fd_table_size)
     {
         return 0;
     }
-    pcb_t *mem_ptr = (pcb_t *)(BOTTOM_KERNEL - (PROCESS_SIZE * (terminals[current_terminal_run].current_pid + 1)));
-    file_descriptor_t *file_descriptor = &mem_ptr->file_descriptor_table[fd];
-    return file_descriptor;
+    return mem_ptr->file_descriptor_table[fd];
 }
 
 /* parse_cmd
@@ -165,7 +292,7 @@ uint8_t parse_second_arg(const uint8_t *args)
     uint8_t arg2_end = 0;
     uint8_t unparsed_cmd_length = 0;
     uint8_t parsed_arg_length = 0;
-    uint8_t parsed_arg[MAX_CMD_SIZE];
+    uint8_t parsed_arg[MAX_FILE_NAME + 1];
     unparsed_cmd_length = strlen((int8_t *)args);
 
     int i;
@@ -223,8 +350,8 @@ uint8_t parse_second_arg(const uint8_t *args)
     }
 
     parsed_arg_length = arg2_end - arg2_start;
-    // Arg too long so only copy 32 chars
-    if (parsed_arg_length <= MAX_FILE_NAME)
+    // Arg too long so it is treated as invalid
+    if (parsed_arg_length < MAX_FILE_NAME)
     {
         // Copy the argument
         for (i = 0; i < parsed_arg_length; i++)
@@ -235,16 +362,10 @@ uint8_t parse_second_arg(const uint8_t *args)
     else
     {
         // Invalid argument
-        for (i = 0; i < parsed_arg_length; i++)
-        {
-            parsed_arg[i] = '\0';
-        }
+        i = 0;
     }
 
-    if (i != MAX_CMD_SIZE)
-    {
-        parsed_arg[i] = '\0';
-    }
+    parsed_arg[i] = '\0';
 
     pcb_t *mem_ptr = (pcb_t *)(BOTTOM_KERNEL - (PROCESS_SIZE * (terminals[current_terminal_run].current_pid + 1)));
     memcpy((char *)mem_ptr->arg, (int8_t *)parsed_arg, strlen((int8_t *)parsed_arg));
@@ -253,34 +374,38 @@ uint8_t parse_second_arg(const uint8_t *args)
 
 /* exe_check
  *
- *  Input: cmd, buffer
- *  Output: -1 if command is not an executable file
- *           num_byte, size of the buffer, if cmd is an exe file.
- *  Description: Checks if the cmd is an exe file.
+ *  Input: cmd, dentry to fill in, header buffer of EXE_HEADER_SIZE bytes
+ *  Output: -1 if command is not an executable file that fits in the program image
+ *           num_byte, length of the file, if cmd is an exe file.
+ *  Description: Checks if the cmd is an exe file. Only the header is read;
+ *               the rest is loaded straight into the program image later.
  */
-int32_t exe_check(uint8_t *cmd, uint8_t *buffer)
+int32_t exe_check(uint8_t *cmd, dentry_t *dentry, uint8_t *header)
 {
     /* 3. File checks */
-    dentry_t temp_dentry;
-    if (read_dentry_by_name(cmd, &temp_dentry) == -1)
+    stat_t info;
+    if (read_dentry_by_name(cmd, dentry) == -1 || dentry->fileType != REGULAR_FILE_TYPE)
+    {
+        return -1;
+    }
+    if (inode_stat(dentry->inodeNum, dentry->fileType, &info) == -1 ||
+        info.length < EXE_HEADER_SIZE || info.length > END_PROGRAM - PROGRAM_IMAGE)
     {
         return -1;
     }
-    inode_t *node = global_inode_t + temp_dentry.inodeNum;
-    int32_t num_byte = read_data(temp_dentry.inodeNum, 0, buffer, node->length);
-    if (num_byte <= 0)
+    if (read_data(dentry->inodeNum, 0, header, EXE_HEADER_SIZE) != EXE_HEADER_SIZE)
     {
         return -1;
     }
     /* Checking if file is an executable */
-    if (buffer[0] != EXE_MAGIC_NUM1 ||
-        buffer[1] != EXE_MAGIC_NUM2 ||
-        buffer[2] != EXE_MAGIC_NUM3 ||
-        buffer[3] != EXE_MAGIC_NUM4)
+    if (header[0] != EXE_MAGIC_NUM1 ||
+        header[1] != EXE_MAGIC_NUM2 ||
+        header[2] != EXE_MAGIC_NUM3 ||
+        header[3] != EXE_MAGIC_NUM4)
     {
         return -1;
     }
-    return num_byte;
+    return info.length;
 }
 
 /* create_pcb
@@ -328,33 +453,45 @@ void create_pcb(int8_t terminal_num)
     {
         mem_ptr->arg[j] = 0;
     }
+    // Accounting starts over for the new process in this slot
+    memset(&process_syscall_stats[mem_ptr->pid], 0, sizeof(syscall_stats_t));
     // Creates file descriptor table
-    // Add fd for stdin
-    mem_ptr->file_descriptor_table[0].inode = 0;
-    mem_ptr->file_descriptor_table[0].file_position = 0;
-    mem_ptr->file_descriptor_table[0].flags = 1;
-    mem_ptr->file_descriptor_table[0].file_operations_table_ptr = &stdin_table;
-    mem_ptr->file_descriptor_table[0].file_operations_table_ptr->open = &terminal_open;
-    mem_ptr->file_descriptor_table[0].file_operations_table_ptr->close = &terminal_close;
-    mem_ptr->file_descriptor_table[0].file_operations_table_ptr->read = &terminal_read;
-    mem_ptr->file_descriptor_table[0].file_operations_table_ptr->write = 0;
-
-    // Add fd for stdout
-    mem_ptr->file_descriptor_table[1].inode = 0;
-    mem_ptr->file_descriptor_table[1].file_position = 0;
-    mem_ptr->file_descriptor_table[1].flags = 1;
-    mem_ptr->file_descriptor_table[1].file_operations_table_ptr = &stdout_table;
-    mem_ptr->file_descriptor_table[1].file_operations_table_ptr->open = &terminal_open;
-    mem_ptr->file_descriptor_table[1].file_operations_table_ptr->close = &terminal_close;
-    mem_ptr->file_descriptor_table[1].file_operations_table_ptr->read = 0;
-    mem_ptr->file_descriptor_table[1].file_operations_table_ptr->write = &terminal_write;
-
-    for (i = 2; i < FD_TABLE_SIZE; i++)
-    {
-        mem_ptr->file_descriptor_table[i].inode = 0;
-        mem_ptr->file_descriptor_table[i].file_position = 0;
-        mem_ptr->file_descriptor_table[i].flags = 0;
-        mem_ptr->file_descriptor_table[i].file_operations_table_ptr = 0;
+    mem_ptr->file_descriptor_table = mem_ptr->fd_small;
+    mem_ptr->fd_table_size = FD_TABLE_SIZE;
+    for (i = 0; i < FD_TABLE_SIZE; i++)
+    {
+        mem_ptr->fd_small[i] = 0;
+    }
+    if (terminal_num == -1)
+    {
+        // Children share stdin and stdout with their parent, wherever the parent pointed them
+        pcb_t *parent_ptr = (pcb_t *)(BOTTOM_KERNEL - (PROCESS_SIZE * (mem_ptr->parent_id + 1)));
+        for (i = 0; i < 2 && i < parent_ptr->fd_table_size; i++)
+        {
+            mem_ptr->fd_small[i] = parent_ptr->file_descriptor_table[i];
+            if (mem_ptr->fd_small[i] != 0)
+            {
+                mem_ptr->fd_small[i]->refcount++;
+            }
+        }
+    }
+    else
+    {
+        // Add fd for stdin
+        mem_ptr->fd_small[0] = alloc_open_file();
+        if (mem_ptr->fd_small[0] != 0)
+        {
+            mem_ptr->fd_small[0]->flags = FD_OPEN;
+            mem_ptr->fd_small[0]->file_operations_table_ptr = &stdin_table;
+        }
+
+        // Add fd for stdout
+        mem_ptr->fd_small[1] = alloc_open_file();
+        if (mem_ptr->fd_small[1] != 0)
+        {
+            mem_ptr->fd_small[1]->flags = FD_OPEN;
+            mem_ptr->fd_small[1]->file_operations_table_ptr = &stdout_table;
+        }
     }
     // Set to active
     mem_ptr->active = 1;
@@ -394,14 +531,15 @@ void map(uint32_t vaddr, uint32_t paddr)
 
 /* load_exe_data
  *
- *  Input: buffer, length
+ *  Input: inode of the executable, length
  *  Output: none
- *  Description: puts buffer into program image memory
+ *  Description: reads the executable straight into program image memory
+ *               (the new process's page must already be mapped)
  */
-void load_exe_data(uint8_t *buffer, uint32_t length)
+void load_exe_data(uint32_t inode, uint32_t length)
 {
     uint8_t *program_ptr = (uint8_t *)PROGRAM_IMAGE;
-    memcpy(program_ptr, buffer, length);
+    read_data(inode, 0, program_ptr, length);
     return;
 }
 
@@ -427,11 +565,11 @@ int32_t execute(const uint8_t *command)
     {
         return -1;
     }
-    // MAGIC NUM: a large buffer that ensures it can fit any execute cmd given.
-    uint8_t buffer[100000];
+    dentry_t exe_dentry;
+    uint8_t buffer[EXE_HEADER_SIZE];
     uint8_t cmd[MAX_CMD_SIZE];
     parse_cmd(command, cmd);
-    int32_t num_byte = exe_check(cmd, buffer);
+    int32_t num_byte = exe_check(cmd, &exe_dentry, buffer);
     if (num_byte == -1)
     {
         return -1;
@@ -447,7 +585,7 @@ int32_t execute(const uint8_t *command)
     map(VIRTUAL_ADDR, BOTTOM_KERNEL + terminals[current_terminal_run].current_pid * FOUR_MB);
 
     // Load data
-    load_exe_data(buffer, num_byte);
+    load_exe_data(exe_dentry.inodeNum, num_byte);
 
     uint32_t byte24 = buffer[EIP_BYTE1];
     uint32_t byte25 = buffer[EIP_BYTE2];
@@ -471,12 +609,12 @@ int32_t execute(const uint8_t *command)
 int32_t execute_base_shell(uint8_t terminal_num)
 {
     cli();
-    // MAGIC NUM: a large buffer that ensures it can fit any execute cmd given.
-    uint8_t buffer[100000];
+    dentry_t exe_dentry;
+    uint8_t buffer[EXE_HEADER_SIZE];
     uint8_t cmd[MAX_CMD_SIZE];
     uint8_t *command = (uint8_t *)"shell";
     parse_cmd(command, cmd);
-    int32_t num_byte = exe_check(cmd, buffer);
+    int32_t num_byte = exe_check(cmd, &exe_dentry, buffer);
     if (num_byte == -1)
     {
         return -1;
@@ -492,7 +630,7 @@ int32_t execute_base_shell(uint8_t terminal_num)
     map(VIRTUAL_ADDR, BOTTOM_KERNEL + terminals[terminal_num].current_pid * FOUR_MB);
 
     // Load data
-    load_exe_data(buffer, num_byte);
+    load_exe_data(exe_dentry.inodeNum, num_byte);
 
     uint32_t byte24 = buffer[EIP_BYTE1];
     uint32_t byte25 = buffer[EIP_BYTE2];
@@ -550,36 +688,57 @@ int32_t terminal_switch(int32_t terminal_num)
     {
         return -1;
     }
-    // Save the current terminal video memory to its backup
-    memcpy((uint8_t *)terminal_address[current_terminal_view], (uint8_t *)VIDEO, FOUR_KB_BOUNDARIES);
-    // Load the new terminal backup to video memory
-    memcpy((uint8_t *)VIDEO, (uint8_t *)terminal_address[terminal_num], FOUR_KB_BOUNDARIES);
-    // Switch terminal
+    // Leave the scrollback, which is only drawn for the terminal on screen
+    scrollback_reset();
+    // Switch terminal; its page is already up to date, so only the CRTC start address moves
     current_terminal_view = terminal_num;
+    set_display_start((uint32_t)terminal_screen(terminal_num));
     update_cursor(terminals[current_terminal_view].screen_x, terminals[current_terminal_view].screen_y);
     return 0;
 }
 
+/* read_would_block
+ *
+ *  Input: open file and its fd
+ *  Output: 1 if the file is O_NONBLOCK and its read would wait, else 0
+ *  Description: asks the device's poll callback; files and directories never wait
+ */
+static int32_t read_would_block(file_descriptor_t *file_descriptor_ptr, int32_t fd)
+{
+    wait_queue_t *queue;
+    const file_operations_table_t *ops = file_descriptor_ptr->file_operations_table_ptr;
+    if ((file_descriptor_ptr->flags & O_NONBLOCK) == 0 || ops->poll == 0)
+    {
+        return 0;
+    }
+    return (ops->poll(fd, &queue) & POLLIN) == 0;
+}
+
 /* read
  *
  * reads system call that implements a read of data
  * Inputs: the file descriptor, a buffer to store the read data and the number of bytes to read by using jump table
- * Outputs: num_bytes_read 0 if end of file, -1 if bad data block number or inode
+ * Outputs: num_bytes_read 0 if end of file, -1 if bad data block number or inode,
+ *          WOULD_BLOCK if the fd is O_NONBLOCK and nothing is ready
  * Side Effects: Changes buffer
  */
 int32_t read(int32_t fd, void *buf, int32_t nbytes)
 {
     // Check name and buffer is not NULL
-    if (fd >= FD_TABLE_SIZE || fd < 0 || buf == NULL || nbytes < 0)
+    if (buf == NULL || nbytes < 0)
     {
         return -1;
     }
     file_descriptor_t *file_descriptor_ptr = find_pcb(fd);
     // This fd is not active
-    if (file_descriptor_ptr->flags == 0 || file_descriptor_ptr->file_operations_table_ptr->read == 0)
+    if (file_descriptor_ptr == NULL || file_descriptor_ptr->flags == 0 || file_descriptor_ptr->file_operations_table_ptr->read == 0)
     {
         return -1;
     }
+    if (read_would_block(file_descriptor_ptr, fd))
+    {
+        return WOULD_BLOCK;
+    }
     int32_t num_byte_read = file_descriptor_ptr->file_operations_table_ptr->read(fd, buf, nbytes);
     return num_byte_read;
 }
@@ -594,13 +753,13 @@ int32_t read(int32_t fd, void *buf, int32_t nbytes)
 int32_t write(int32_t fd, const void *buf, int32_t nbytes)
 {
     // Check name and buffer is not NULL
-    if (fd >= FD_TABLE_SIZE || fd < 0 || buf == NULL || nbytes < 0)
+    if (buf == NULL || nbytes < 0)
     {
         return -1;
     }
     file_descriptor_t *file_descriptor_ptr = find_pcb(fd);
     // This fd is not active
-    if (file_descriptor_ptr->flags == 0 || file_descriptor_ptr->file_operations_table_ptr->write == 0)
+    if (file_descriptor_ptr == NULL || file_descriptor_ptr->flags == 0 || file_descriptor_ptr->file_operations_table_ptr->write == 0)
     {
         return -1;
     }
@@ -608,6 +767,351 @@ int32_t write(int32_t fd, const void *buf, int32_t nbytes)
     return num_byte_write;
 }
 
+// Jump table in system_call_linkage.S; every call is given four arguments and uses what it needs
+extern int32_t (*const jump_table[NUM_SYSCALLS])(uint32_t, uint32_t, uint32_t, uint32_t);
+
+/* syscall_dispatch
+ *
+ *  Input: system call number (already range checked), the four argument registers
+ *  Output: the system call's return value
+ *  Description: called by both entry paths; runs the system call and charges its cycles to the
+ *               calling process and to the totals. Calls are counted on the way in, so halt
+ *               (which never returns here) is counted too.
+ */
+int32_t syscall_dispatch(uint32_t number, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4)
+{
+    syscall_counter_t *mine = &process_syscall_stats[terminals[current_terminal_run].current_pid].syscalls[number];
+    syscall_counter_t *all = &all_syscall_stats.syscalls[number];
+    uint64_t elapsed;
+    uint32_t bucket;
+    int32_t ret;
+    mine->calls++;
+    all->calls++;
+    elapsed = rdtsc();
+    ret = jump_table[number](arg1, arg2, arg3, arg4);
+    elapsed = rdtsc() - elapsed;
+    // log2 of the cycles, with anything from 2^32 up in the top bucket
+    bucket = (elapsed >> 32) ? SYSCALL_HISTOGRAM_BUCKETS - 1 : ((uint32_t)elapsed ? 31 - __builtin_clz((uint32_t)elapsed) : 0);
+    mine->cycles += elapsed;
+    mine->histogram[bucket]++;
+    all->cycles += elapsed;
+    all->histogram[bucket]++;
+    return ret;
+}
+
+/* syscall_stats
+ *
+ *  Input: SYSCALL_STATS_SELF or SYSCALL_STATS_ALL, user buffer for the counters
+ *  Output: 0 on success, else -1 if error
+ *  Description: system call that copies out call counts, total cycles and log2 cycle histograms
+ *               for every system call number
+ */
+int32_t syscall_stats(int32_t which, syscall_stats_t *buf)
+{
+    uint32_t buf32 = (uint32_t)buf;
+    if (buf == NULL || buf32 < START_PROGRAM || buf32 > END_PROGRAM - sizeof(syscall_stats_t))
+    {
+        return -1;
+    }
+    if (which == SYSCALL_STATS_SELF)
+    {
+        memcpy(buf, &process_syscall_stats[terminals[current_terminal_run].current_pid], sizeof(syscall_stats_t));
+    }
+    else if (which == SYSCALL_STATS_ALL)
+    {
+        memcpy(buf, &all_syscall_stats, sizeof(syscall_stats_t));
+    }
+    else
+    {
+        return -1;
+    }
+    return 0;
+}
+
+// Stack SYSENTER lands on; sysenter_link moves to the process's kernel stack before using it
+static uint32_t sysenter_stack[SYSENTER_STACK_WORDS];
+
+/* sysenter_init
+ *
+ *  Input: none
+ *  Output: 0 if SYSENTER now enters the kernel, -1 if the CPU does not have it
+ *  Description: points the SYSENTER MSRs at sysenter_link; int $0x80 keeps working either way
+ */
+int32_t sysenter_init(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(CPUID_FEATURES, &eax, &ebx, &ecx, &edx);
+    // Early Pentium Pros set the bit without having the instructions
+    if (!(edx & CPUID_EDX_SEP) ||
+        (CPUID_FAMILY(eax) == 6 && CPUID_MODEL(eax) < 3 && CPUID_STEPPING(eax) < 3))
+    {
+        return -1;
+    }
+    wrmsr(MSR_SYSENTER_CS, KERNEL_CS, 0);
+    wrmsr(MSR_SYSENTER_ESP, (uint32_t)&sysenter_stack[SYSENTER_STACK_WORDS], 0);
+    wrmsr(MSR_SYSENTER_EIP, (uint32_t)sysenter_link, 0);
+    return 0;
+}
+
+/* transfer_vector
+ *
+ *  Input: fd, user array of buffers, number of buffers, 1 to write or 0 to read
+ *  Output: total bytes moved, else -1 if error before anything was moved
+ *  Description: checks every buffer first, then hands them to the fd's read or write in order,
+ *               stopping at the first short transfer so the data has no gap in it
+ */
+static int32_t transfer_vector(int32_t fd, const iovec_t *iov, int32_t iovcnt, int32_t to_write)
+{
+    uint32_t iov32 = (uint32_t)iov;
+    uint32_t base32, total = 0;
+    int32_t i, num;
+    if (iov == NULL || iovcnt <= 0 || iovcnt > IOV_MAX)
+    {
+        return -1;
+    }
+    // The array and every buffer must be in the program's page
+    if (iov32 < START_PROGRAM || iov32 > END_PROGRAM - iovcnt * sizeof(iovec_t))
+    {
+        return -1;
+    }
+    for (i = 0; i < iovcnt; i++)
+    {
+        base32 = (uint32_t)iov[i].base;
+        if (base32 < START_PROGRAM || iov[i].length > END_PROGRAM - START_PROGRAM || base32 > END_PROGRAM - iov[i].length)
+        {
+            return -1;
+        }
+        total += iov[i].length;
+    }
+    if (total > INT32_MAX)
+    {
+        return -1;
+    }
+    file_descriptor_t *file_descriptor_ptr = find_pcb(fd);
+    if (file_descriptor_ptr == NULL || file_descriptor_ptr->flags == 0 ||
+        (to_write ? file_descriptor_ptr->file_operations_table_ptr->write == 0 : file_descriptor_ptr->file_operations_table_ptr->read == 0))
+    {
+        return -1;
+    }
+    if (!to_write && read_would_block(file_descriptor_ptr, fd))
+    {
+        return WOULD_BLOCK;
+    }
+    total = 0;
+    for (i = 0; i < iovcnt; i++)
+    {
+        if (to_write)
+        {
+            num = file_descriptor_ptr->file_operations_table_ptr->write(fd, iov[i].base, iov[i].length);
+        }
+        else
+        {
+            num = file_descriptor_ptr->file_operations_table_ptr->read(fd, iov[i].base, iov[i].length);
+        }
+        if (num == -1)
+        {
+            return (total == 0) ? -1 : total;
+        }
+        total += num;
+        if (num < iov[i].length)
+        {
+            break;
+        }
+    }
+    return total;
+}
+
+/* readv
+ *
+ *  Input: fd, user array of buffers, number of buffers (at most IOV_MAX)
+ *  Output: total bytes read, 0 at end of file, WOULD_BLOCK as for read, else -1 if error
+ *  Description: system call that fills several buffers in one kernel entry
+ */
+int32_t readv(int32_t fd, const iovec_t *iov, int32_t iovcnt)
+{
+    return transfer_vector(fd, iov, iovcnt, 0);
+}
+
+/* writev
+ *
+ *  Input: fd, user array of buffers, number of buffers (at most IOV_MAX)
+ *  Output: total bytes written, else -1 if error
+ *  Description: system call that writes several buffers in one kernel entry, so a line
+ *               built from pieces costs one crossing instead of one per piece
+ */
+int32_t writev(int32_t fd, const iovec_t *iov, int32_t iovcnt)
+{
+    return transfer_vector(fd, iov, iovcnt, 1);
+}
+
+/* poll_scan
+ *
+ *  Input: user array of descriptors, how many, arrays for each one's queue and its wakeups when checked
+ *  Output: number of descriptors with something to report
+ *  Description: fills in revents; run with interrupts off so a wake after a check is still seen
+ */
+static int32_t poll_scan(pollfd_t *fds, int32_t nfds, wait_queue_t **queues, uint32_t *seen)
+{
+    const file_operations_table_t *ops;
+    file_descriptor_t *file_descriptor_ptr;
+    uint32_t events;
+    int32_t i, ready = 0;
+    for (i = 0; i < nfds; i++)
+    {
+        queues[i] = 0;
+        file_descriptor_ptr = find_pcb(fds[i].fd);
+        if (file_descriptor_ptr == NULL || file_descriptor_ptr->flags == 0)
+        {
+            fds[i].revents = POLLNVAL;
+            ready++;
+            continue;
+        }
+        ops = file_descriptor_ptr->file_operations_table_ptr;
+        if (ops->poll != 0)
+        {
+            events = ops->poll(fds[i].fd, &queues[i]);
+        }
+        else
+        {
+            events = (ops->read ? POLLIN : 0) | (ops->write ? POLLOUT : 0);
+        }
+        if (queues[i] != 0)
+        {
+            seen[i] = queues[i]->wakeups;
+        }
+        fds[i].revents = events & fds[i].events;
+        if (fds[i].revents != 0)
+        {
+            ready++;
+        }
+    }
+    return ready;
+}
+
+/* poll
+ *
+ *  Input: user array of descriptors and the events wanted on each, how many (at most POLL_MAX_FDS),
+ *         timeout in milliseconds (0 to only check, less than 0 to wait for as long as it takes)
+ *  Output: number of descriptors with events in revents, 0 on timeout, else -1 if error
+ *  Description: system call that waits on several descriptors at once, e.g. keys and RTC ticks.
+ *               Between checks it sleeps until one of their wait queues is woken, not spinning.
+ */
+int32_t poll(pollfd_t *fds, int32_t nfds, int32_t timeout)
+{
+    uint32_t fds32 = (uint32_t)fds;
+    wait_queue_t *queues[POLL_MAX_FDS];
+    uint32_t seen[POLL_MAX_FDS];
+    uint32_t start, ticks;
+    int32_t i, ready, woken;
+    if (fds == NULL || nfds <= 0 || nfds > POLL_MAX_FDS || fds32 < START_PROGRAM || fds32 > END_PROGRAM - nfds * sizeof(pollfd_t))
+    {
+        return -1;
+    }
+    // Whole seconds first so a long timeout cannot overflow; round the rest up so a short timeout still waits a tick
+    ticks = (timeout > 0) ? (uint32_t)timeout / 1000 * PIT_HZ + ((uint32_t)timeout % 1000 * PIT_HZ + 999) / 1000 : 0;
+    start = pit_wait.wakeups;
+    cli();
+    while ((ready = poll_scan(fds, nfds, queues, seen)) == 0)
+    {
+        if (timeout == 0 || (timeout > 0 && pit_wait.wakeups - start >= ticks))
+        {
+            break;
+        }
+        // Nothing is ready; halt until an interrupt wakes one of the queues or the time is up
+        do
+        {
+            // "sti; hlt" cannot miss the wake up
+            asm volatile("sti; hlt; cli");
+            woken = (timeout > 0 && pit_wait.wakeups - start >= ticks);
+            for (i = 0; i < nfds && !woken; i++)
+            {
+                woken = (queues[i] != 0 && queues[i]->wakeups != seen[i]);
+            }
+        } while (!woken);
+    }
+    sti();
+    return ready;
+}
+
+/* ring_request
+ *
+ *  Input: a request copied out of the ring
+ *  Output: what the matching system call returns
+ *  Description: runs one ring request; buffers are checked like pread checks them
+ */
+static int32_t ring_request(const ring_sqe_t *sqe)
+{
+    uint32_t buf32 = (uint32_t)sqe->buf;
+    uint32_t i;
+    switch (sqe->opcode)
+    {
+    case RING_OP_READ:
+    case RING_OP_WRITE:
+        // The length first, so END_PROGRAM - nbytes cannot wrap
+        if (sqe->nbytes < 0 || sqe->nbytes > END_PROGRAM - START_PROGRAM || buf32 < START_PROGRAM || buf32 > END_PROGRAM - sqe->nbytes)
+        {
+            return -1;
+        }
+        return (sqe->opcode == RING_OP_READ) ? read(sqe->fd, sqe->buf, sqe->nbytes) : write(sqe->fd, sqe->buf, sqe->nbytes);
+    case RING_OP_OPEN:
+        if (buf32 < START_PROGRAM || buf32 >= END_PROGRAM)
+        {
+            return -1;
+        }
+        // The name must end before the program's page does (open takes no more than MAX_PATH_LENGTH anyway)
+        for (i = 0; buf32 + i < END_PROGRAM && i <= MAX_PATH_LENGTH; i++)
+        {
+            if (((uint8_t *)sqe->buf)[i] == '\0')
+            {
+                return open((uint8_t *)sqe->buf);
+            }
+        }
+        return -1;
+    case RING_OP_CLOSE:
+        return close(sqe->fd);
+    default:
+        return -1;
+    }
+}
+
+/* ring_enter
+ *
+ *  Input: ring in the program's memory, most requests to run (0 or less runs all that are posted)
+ *  Output: number of requests run, else -1 if the ring is not in the program's page or is corrupt
+ *  Description: system call that runs a batch of posted reads, writes, opens and closes in order,
+ *               posting a completion for each, so many small requests cost one kernel entry.
+ *               Stops early when the completion ring is full.
+ */
+int32_t ring_enter(io_ring_t *ring, int32_t to_submit)
+{
+    uint32_t ring32 = (uint32_t)ring;
+    uint32_t sq_tail, done = 0;
+    ring_sqe_t sqe;
+    ring_cqe_t *cqe;
+    if (ring == NULL || ring32 < START_PROGRAM || ring32 > END_PROGRAM - sizeof(io_ring_t))
+    {
+        return -1;
+    }
+    // Read the program's tail once; entries posted after this wait for the next call
+    sq_tail = ring->sq_tail;
+    if (sq_tail - ring->sq_head > RING_ENTRIES || ring->cq_tail - ring->cq_head > RING_ENTRIES)
+    {
+        return -1;
+    }
+    while (ring->sq_head != sq_tail && (to_submit <= 0 || done < to_submit) &&
+           ring->cq_tail - ring->cq_head < RING_ENTRIES)
+    {
+        sqe = ring->sq[ring->sq_head & (RING_ENTRIES - 1)];
+        ring->sq_head++;
+        cqe = &ring->cq[ring->cq_tail & (RING_ENTRIES - 1)];
+        cqe->user_data = sqe.user_data;
+        cqe->result = ring_request(&sqe);
+        ring->cq_tail++;
+        done++;
+    }
+    return done;
+}
+
 /* open
  *
  * open system call that checks file type and adds to fd table
@@ -617,75 +1121,45 @@ int32_t write(int32_t fd, const void *buf, int32_t nbytes)
  */
 int32_t open(const uint8_t *filename)
 {
-    int i;
     int fd = -1;
-    dentry_t den;
+    uint32_t inode;
+    const file_operations_table_t *ops;
     file_descriptor_t *file_descriptor_ptr;
     // Check if valid input
-    if (strlen((int8_t *)filename) == 0 || strlen((int8_t *)filename) > ENTRY_NAME || read_dentry_by_name(filename, &den) == -1)
+    if (strlen((int8_t *)filename) == 0 || strlen((int8_t *)filename) > MAX_PATH_LENGTH)
     {
         return -1;
     }
-    // check if the dentry has correct type
-    if (den.fileType != 0 && den.fileType != 1 && den.fileType != 2)
+    // A file, a directory or a registered device; the table is shared, never written
+    ops = vfs_resolve(filename, &inode);
+    if (ops == 0)
     {
         return -1;
     }
 
-    // correct values are used and now we find fd number by traversing
-    // MAGIC NUM: 2 is start of array or 3rd index and 8 is the max number of files in array
-    for (i = 2; i < FD_TABLE_SIZE; i++)
-    {
-        file_descriptor_ptr = find_pcb(i);
-
-        if (file_descriptor_ptr->flags == 0)
-        {
-            fd = i;
-            break;
-        }
-    }
+    // correct values are used and now we find the lowest free fd after stdin and stdout
+    // (the table grows if it is full)
+    pcb_t *mem_ptr = (pcb_t *)(BOTTOM_KERNEL - (PROCESS_SIZE * (terminals[current_terminal_run].current_pid + 1)));
+    fd = fd_alloc(mem_ptr, 2);
     // if no space found return -1
     if (fd == -1)
     {
         return -1;
     }
-
-    // initialize the descriptor
-    file_descriptor_ptr->flags = 1;
-    file_descriptor_ptr->file_position = 0;
-    // RTC
-    if (den.fileType == 0)
-    {
-        file_descriptor_ptr->inode = 0;
-        file_descriptor_ptr->file_operations_table_ptr = &rtc_table;
-        file_descriptor_ptr->file_operations_table_ptr->open = &rtc_open;
-        file_descriptor_ptr->file_operations_table_ptr->close = &rtc_close;
-        file_descriptor_ptr->file_operations_table_ptr->read = &rtc_read;
-        file_descriptor_ptr->file_operations_table_ptr->write = &rtc_write;
-    }
-    // Dentry
-    else if (den.fileType == 1)
-    {
-        file_descriptor_ptr->inode = 0;
-        file_descriptor_ptr->file_operations_table_ptr = &dentry_table;
-        file_descriptor_ptr->file_operations_table_ptr->open = &directory_open;
-        file_descriptor_ptr->file_operations_table_ptr->close = &directory_close;
-        file_descriptor_ptr->file_operations_table_ptr->read = &directory_read;
-        file_descriptor_ptr->file_operations_table_ptr->write = &directory_write;
-    }
-    // Regular file
-    else
+    file_descriptor_ptr = alloc_open_file();
+    if (file_descriptor_ptr == 0)
     {
-        file_descriptor_ptr->inode = den.inodeNum;
-        file_descriptor_ptr->file_operations_table_ptr = &file_table;
-        file_descriptor_ptr->file_operations_table_ptr->open = &file_open;
-        file_descriptor_ptr->file_operations_table_ptr->close = &file_close;
-        file_descriptor_ptr->file_operations_table_ptr->read = &file_read;
-        file_descriptor_ptr->file_operations_table_ptr->write = &file_write;
+        return -1;
     }
+    mem_ptr->file_descriptor_table[fd] = file_descriptor_ptr;
+
+    // initialize the descriptor
+    file_descriptor_ptr->flags = FD_OPEN;
+    file_descriptor_ptr->inode = inode;
+    file_descriptor_ptr->file_operations_table_ptr = ops;
 
     // call open from jump table
-    file_descriptor_ptr->file_operations_table_ptr->open(filename);
+    ops->open(filename);
 
     return fd;
 }
@@ -698,24 +1172,144 @@ int32_t open(const uint8_t *filename)
  */
 int32_t close(int32_t fd)
 {
-    // Fail if fd is out of bounds of array or try to close stdin or stdout
-    if (fd >= FD_TABLE_SIZE || fd < 2)
+    // Fail if try to close stdin or stdout
+    if (fd < 2)
     {
         return -1;
     }
     file_descriptor_t *file_descriptor_ptr = find_pcb(fd);
     // This fd is not active
-    if (file_descriptor_ptr->flags == 0)
+    if (file_descriptor_ptr == NULL || file_descriptor_ptr->flags == 0)
+    {
+        return -1;
+    }
+    // The open file stays while other descriptors still refer to it
+    pcb_t *mem_ptr = (pcb_t *)(BOTTOM_KERNEL - (PROCESS_SIZE * (terminals[current_terminal_run].current_pid + 1)));
+    fd_release(mem_ptr, fd);
+    return 0;
+}
+
+/* fcntl
+ *
+ *  Input: fd, F_GETFL or F_SETFL, the new O_ flags for F_SETFL
+ *  Output: the O_ flags for F_GETFL, 0 for F_SETFL, else -1 if error
+ *  Description: system call that gets or sets an open file's flags; dups of fd share them
+ */
+int32_t fcntl(int32_t fd, int32_t cmd, int32_t arg)
+{
+    file_descriptor_t *file_descriptor_ptr = find_pcb(fd);
+    if (file_descriptor_ptr == NULL || file_descriptor_ptr->flags == 0)
+    {
+        return -1;
+    }
+    switch (cmd)
+    {
+    case F_GETFL:
+        return file_descriptor_ptr->flags & O_NONBLOCK;
+    case F_SETFL:
+        if (arg & ~O_NONBLOCK)
+        {
+            return -1;
+        }
+        file_descriptor_ptr->flags = FD_OPEN | arg;
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+/* time
+ *
+ *  Input: where in the program's page to store the time
+ *  Output: 0 if success, else -1 if error
+ *  Description: system call that gives the seconds since 1970-01-01 00:00 UTC from the copy of
+ *               the CMOS clock the RTC driver keeps, so it costs no CMOS port reads
+ */
+int32_t time(uint32_t *seconds)
+{
+    uint32_t seconds32 = (uint32_t)seconds;
+    if (seconds32 < START_PROGRAM || seconds32 > END_PROGRAM - sizeof(uint32_t))
+    {
+        return -1;
+    }
+    *seconds = wall_clock_now();
+    return 0;
+}
+
+/* cache_stats
+ *
+ *  Input: where in the program's page to store the counters
+ *  Output: 0 if success, else -1 if error
+ *  Description: system call that copies out the page cache's hit, miss, read-ahead and eviction
+ *               counts since boot
+ */
+int32_t cache_stats(struct page_cache_stats *buf)
+{
+    uint32_t buf32 = (uint32_t)buf;
+    if (buf == NULL || buf32 < START_PROGRAM || buf32 > END_PROGRAM - sizeof(page_cache_stats_t))
     {
         return -1;
     }
-    file_descriptor_ptr->file_operations_table_ptr = 0;
-    file_descriptor_ptr->file_position = 0;
-    file_descriptor_ptr->inode = 0;
-    file_descriptor_ptr->flags = 0;
+    page_cache_get_stats(buf);
     return 0;
 }
 
+/* dup
+ *
+ *  Input: fd
+ *  Output: the new fd, else -1 if fd is not open or there is no room
+ *  Description: system call that makes the lowest free fd refer to the same open file as fd
+ *               (the two share a position)
+ */
+int32_t dup(int32_t fd)
+{
+    file_descriptor_t *file_descriptor_ptr = find_pcb(fd);
+    pcb_t *mem_ptr = (pcb_t *)(BOTTOM_KERNEL - (PROCESS_SIZE * (terminals[current_terminal_run].current_pid + 1)));
+    int32_t new_fd;
+    if (file_descriptor_ptr == NULL || file_descriptor_ptr->flags == 0)
+    {
+        return -1;
+    }
+    new_fd = fd_alloc(mem_ptr, 0);
+    if (new_fd == -1)
+    {
+        return -1;
+    }
+    mem_ptr->file_descriptor_table[new_fd] = file_descriptor_ptr;
+    file_descriptor_ptr->refcount++;
+    return new_fd;
+}
+
+/* dup2
+ *
+ *  Input: fd, new_fd
+ *  Output: new_fd, else -1 if fd is not open or new_fd is out of range
+ *  Description: system call that makes new_fd refer to the same open file as fd, closing
+ *               whatever new_fd referred to first; dup2(file, 1) redirects stdout
+ */
+int32_t dup2(int32_t fd, int32_t new_fd)
+{
+    file_descriptor_t *file_descriptor_ptr = find_pcb(fd);
+    pcb_t *mem_ptr = (pcb_t *)(BOTTOM_KERNEL - (PROCESS_SIZE * (terminals[current_terminal_run].current_pid + 1)));
+    if (file_descriptor_ptr == NULL || file_descriptor_ptr->flags == 0 || new_fd < 0)
+    {
+        return -1;
+    }
+    if (new_fd == fd)
+    {
+        return new_fd;
+    }
+    if (fd_table_grow(mem_ptr, new_fd + 1) == -1)
+    {
+        return -1;
+    }
+    // Take the reference first in case new_fd held the last one
+    file_descriptor_ptr->refcount++;
+    fd_release(mem_ptr, new_fd);
+    mem_ptr->file_descriptor_table[new_fd] = file_descriptor_ptr;
+    return new_fd;
+}
+
 /* getargs
  *
  *  Input: pointer to buffer to store arguments and the number of bytes to copy
@@ -775,7 +1369,11 @@ int32_t vidmap(uint8_t **screen_start)
     }
 
     page_table2[0].present = 1;
-    page_table2[0].bits_31_12 = VIDEO_12;
+    // The screen has to start on the page handed out
+    home_terminal(current_terminal_run);
+    terminals[current_terminal_run].vidmap_pid = terminals[current_terminal_run].current_pid;
+    // The terminal's own page, so drawing in the background does not show on another terminal
+    page_table2[0].bits_31_12 = terminal_address[current_terminal_run] >> TWELVE;
 
     uint32_t page_dir_idx = VIDEO_VIRTUAL >> DIVIDE_BY_4MB; // 1 GB >> 22
     page_directory_entry_4K_t temp;
@@ -800,6 +1398,118 @@ int32_t vidmap(uint8_t **screen_start)
     return VIDEO_VIRTUAL;
 }
 
+/* getdents
+ *
+ *  Input: fd of an open directory, user buffer for the records and its size in bytes
+ *  Output: number of bytes of records written, 0 once every entry has been returned, else -1 if error
+ *  Description: system call that lists a directory in as few kernel crossings as possible
+ */
+int32_t getdents(int32_t fd, void *buf, int32_t nbytes)
+{
+    uint32_t buf32 = (uint32_t)buf;
+    if (buf == NULL || nbytes <= 0)
+    {
+        return -1;
+    }
+    // The whole buffer must be in the program's page (the length first, so END_PROGRAM - nbytes cannot wrap)
+    if (buf32 < START_PROGRAM || nbytes > END_PROGRAM - START_PROGRAM || buf32 > END_PROGRAM - nbytes)
+    {
+        return -1;
+    }
+    file_descriptor_t *file_descriptor_ptr = find_pcb(fd);
+    if (file_descriptor_ptr == NULL || file_descriptor_ptr->flags == 0 || file_descriptor_ptr->file_operations_table_ptr->getdents == 0)
+    {
+        return -1;
+    }
+    return file_descriptor_ptr->file_operations_table_ptr->getdents(fd, buf, nbytes);
+}
+
+/* lseek
+ *
+ *  Input: fd of an open file or directory, signed offset, whence (SEEK_SET, SEEK_CUR or SEEK_END)
+ *  Output: the new position, else -1 if error
+ *  Description: system call that moves the position the next read starts from, so a record
+ *               can be reached without reading everything before it
+ */
+int32_t lseek(int32_t fd, int32_t offset, int32_t whence)
+{
+    file_descriptor_t *file_descriptor_ptr = find_pcb(fd);
+    // The terminal and devices have no position
+    if (file_descriptor_ptr == NULL || file_descriptor_ptr->flags == 0 || file_descriptor_ptr->file_operations_table_ptr->lseek == 0)
+    {
+        return -1;
+    }
+    return file_descriptor_ptr->file_operations_table_ptr->lseek(fd, offset, whence);
+}
+
+/* pread
+ *
+ *  Input: fd of an open file, user buffer, number of bytes to read, offset in the file
+ *  Output: number of bytes read, 0 if offset is at or past the end of file, else -1 if error
+ *  Description: system call that reads from a given offset without using or moving the fd's position
+ */
+int32_t pread(int32_t fd, void *buf, int32_t nbytes, int32_t offset)
+{
+    uint32_t buf32 = (uint32_t)buf;
+    if (buf == NULL || nbytes < 0 || offset < 0)
+    {
+        return -1;
+    }
+    // The whole buffer must be in the program's page (the length first, so END_PROGRAM - nbytes cannot wrap)
+    if (buf32 < START_PROGRAM || nbytes > END_PROGRAM - START_PROGRAM || buf32 > END_PROGRAM - nbytes)
+    {
+        return -1;
+    }
+    file_descriptor_t *file_descriptor_ptr = find_pcb(fd);
+    if (file_descriptor_ptr == NULL || file_descriptor_ptr->flags == 0 || file_descriptor_ptr->file_operations_table_ptr->pread == 0)
+    {
+        return -1;
+    }
+    return file_descriptor_ptr->file_operations_table_ptr->pread(fd, buf, nbytes, offset);
+}
+
+/* stat
+ *
+ *  Input: name of a file (or path), user buffer for its stat record
+ *  Output: 0 on success, else -1 if error
+ *  Description: system call that gives a file's inode, type and length without opening or reading it
+ */
+int32_t stat(const uint8_t *filename, stat_t *buf)
+{
+    uint32_t buf32 = (uint32_t)buf;
+    dentry_t den;
+    if (filename == NULL || buf == NULL || buf32 < START_PROGRAM || buf32 > END_PROGRAM - sizeof(stat_t))
+    {
+        return -1;
+    }
+    if (strlen((int8_t *)filename) == 0 || strlen((int8_t *)filename) > MAX_PATH_LENGTH || read_dentry_by_name(filename, &den) == -1)
+    {
+        return -1;
+    }
+    return inode_stat(den.inodeNum, den.fileType, buf);
+}
+
+/* fstat
+ *
+ *  Input: fd of an open file, directory or device, user buffer for its stat record
+ *  Output: 0 on success, else -1 if error (including stdin and stdout)
+ *  Description: system call that gives the stat record of an open file
+ */
+int32_t fstat(int32_t fd, stat_t *buf)
+{
+    uint32_t buf32 = (uint32_t)buf;
+    if (buf == NULL || buf32 < START_PROGRAM || buf32 > END_PROGRAM - sizeof(stat_t))
+    {
+        return -1;
+    }
+    file_descriptor_t *file_descriptor_ptr = find_pcb(fd);
+    if (file_descriptor_ptr == NULL || file_descriptor_ptr->flags == 0 || file_descriptor_ptr->file_operations_table_ptr->fstat == 0)
+    {
+        return -1;
+    }
+    return file_descriptor_ptr->file_operations_table_ptr->fstat(fd, buf);
+}
+
 int32_t set_handler(int32_t signum, void *handler_address)
 {
     return 0;
@@ -1,5 +1,6 @@
 #ifndef SYSTEM_CALL_H
 #define SYSTEM_CALL_H
+#include "vfs.h"
 #include "file_system.h"
 #include "lib.h"
 #include "keyboard.h"
@@ -10,7 +11,7 @@
 #include "scheduling.h"
 
 #define MAX_CMD_SIZE 32
-#define MAX_FILE_NAME 32
+#define MAX_FILE_NAME 128 // Room for paths and long names passed as arguments
 #define MAX_FILE_SIZE 4190208 // 1023 x 4096
 #define EXE_MAGIC_NUM1 0x7F
 #define EXE_MAGIC_NUM2 0x45
@@ -26,31 +27,66 @@
 #define VIDEO_VIRTUAL 0x40000000
 #define START_PROGRAM 0x8000000
 #define END_PROGRAM 0x8400000
-#define FD_TABLE_SIZE 8
+#define FD_TABLE_SIZE 8   // Descriptors every process has room for in its PCB
+#define FD_TABLE_MAX 64   // Descriptors a process can grow to
+#define FD_TABLE_POOL 4   // Grown tables shared by all processes
+#define MAX_OPEN_FILES 64 // Open files shared by all processes
 #define EIP_BYTE1 24
 #define EIP_BYTE2 25
 #define EIP_BYTE3 26
 #define EIP_BYTE4 27
+#define EXE_HEADER_SIZE 28 // Magic number through the entry point
+#define IOV_MAX 16         // Most buffers one readv or writev takes
+
+// Open file flags
+#define FD_OPEN 0x1     // In use
+#define O_NONBLOCK 0x2  // A read that would wait returns WOULD_BLOCK instead
+#define F_GETFL 3       // fcntl: get the O_ flags
+#define F_SETFL 4       // fcntl: replace the O_ flags
+#define WOULD_BLOCK -2  // Returned by read and readv on an O_NONBLOCK descriptor with nothing ready
+
+// Per-system call accounting
+#define NUM_SYSCALLS 26               // Jump table entries, with the unused 0 (MAX_SYSCALL in system_call_linkage.S + 1)
+#define SYSCALL_HISTOGRAM_BUCKETS 32  // Bucket i counts calls that took [2^i, 2^(i+1)) cycles
+#define SYSCALL_STATS_SELF 0          // syscall_stats: the calling process since it started
+#define SYSCALL_STATS_ALL 1           // syscall_stats: every process since boot
+
+// Submission/completion ring
+#define RING_ENTRIES 32 // Slots in each ring; a power of 2 so indexes wrap with a mask
+#define RING_OP_READ 0
+#define RING_OP_WRITE 1
+#define RING_OP_OPEN 2  // buf is the file name; nbytes is not used
+#define RING_OP_CLOSE 3
+
+// SYSENTER/SYSEXIT fast system calls (Intel SDM Vol. 2B, SYSENTER)
+#define CPUID_FEATURES 1           // CPUID leaf with the feature flags
+#define CPUID_EDX_SEP 0x800        // EDX bit 11: SYSENTER and SYSEXIT are there
+#define CPUID_FAMILY(eax) (((eax) >> 8) & 0xF)
+#define CPUID_MODEL(eax) (((eax) >> 4) & 0xF)
+#define CPUID_STEPPING(eax) ((eax) & 0xF)
+#define MSR_SYSENTER_CS 0x174      // Kernel code segment; SS, user CS and user SS follow it in the GDT
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
+#define SYSENTER_STACK_WORDS 16    // Stack SYSENTER lands on, only until the entry code switches
 #define BYTESHIFT1 8
 #define BYTESHIFT2 16
 #define BYTESHIFT3 24
 
-// Function tables
-typedef struct file_operations_table
-{
-    int32_t (*open)(const uint8_t *filename);
-    int32_t (*close)(int32_t fd);
-    int32_t (*read)(int32_t fd, void *buf, int32_t nbytes);
-    int32_t (*write)(int32_t fd, const void *buf, int32_t nbytes);
-} file_operations_table_t;
-
-// File descriptors for each file
+// Open file; every descriptor that refers to it (after dup or in a child) shares its position
 typedef struct file_descriptor
 {
-    file_operations_table_t *file_operations_table_ptr;
+    const file_operations_table_t *file_operations_table_ptr; // Shared, read-only table of its kind
+    uint32_t refcount;        // Descriptors in any process that refer to this open file
     uint32_t inode;
     uint32_t file_position;
-    uint32_t flags;
+    uint32_t flags;           // FD_OPEN, and O_NONBLOCK if set; shared with dups like the position
+    uint32_t readahead_next;  // Where a sequential read would start next
+    uint32_t readahead_pages; // Current read-ahead window
+    uint32_t cursor_length;   // File length, valid while cursor_block is set
+    uint32_t cursor_index;    // Index within the file of the block last read
+    uint32_t cursor_block;    // Absolute number of that block, 0 if nothing is cached yet
+    uint32_t rtc_period;      // Virtual RTC: 1/1024 s between ticks, 0 until first used
+    uint32_t rtc_deadline;    // Virtual RTC: time of the next tick
 } file_descriptor_t;
 
 // PCB for each process
@@ -58,7 +94,9 @@ typedef struct pcb
 {
     uint32_t pid;
     int32_t parent_id;
-    file_descriptor_t file_descriptor_table[FD_TABLE_SIZE];
+    file_descriptor_t **file_descriptor_table; // fd_small, or a grown table from the pool
+    uint32_t fd_table_size;
+    file_descriptor_t *fd_small[FD_TABLE_SIZE];
     uint32_t saved_esp;
     uint32_t saved_ebp;
     uint32_t parent_saved_esp;
@@ -68,14 +106,76 @@ typedef struct pcb
     uint32_t saved_eip;
 } pcb_t;
 
-file_descriptor_t *find_pcb(uint8_t fd);
+// One buffer of a readv or writev
+typedef struct iovec
+{
+    void *base;
+    uint32_t length;
+} iovec_t;
+
+// Accounting for one system call number; cycles run from dispatch to return, so a
+// call that blocks (or an execute that runs a child) includes the time it waited
+typedef struct syscall_counter
+{
+    uint32_t calls;
+    uint64_t cycles;
+    uint32_t histogram[SYSCALL_HISTOGRAM_BUCKETS];
+} syscall_counter_t;
+
+typedef struct syscall_stats
+{
+    syscall_counter_t syscalls[NUM_SYSCALLS];
+} syscall_stats_t;
+
+// One descriptor poll watches
+typedef struct pollfd
+{
+    int32_t fd;
+    uint16_t events;  // POLLIN and/or POLLOUT
+    uint16_t revents; // Which of them are ready, or POLLNVAL
+} pollfd_t;
+
+// Request posted to a ring
+typedef struct ring_sqe
+{
+    uint32_t opcode;
+    int32_t fd;
+    void *buf;
+    int32_t nbytes;
+    uint32_t user_data; // Copied to the completion so the program can match them up
+} ring_sqe_t;
+
+// Result of one request
+typedef struct ring_cqe
+{
+    uint32_t user_data;
+    int32_t result; // What the system call would have returned
+} ring_cqe_t;
+
+// Rings in the program's own memory; the program owns sq_tail and cq_head, the kernel sq_head and cq_tail
+// Counters run freely and are masked with RING_ENTRIES - 1 to index
+typedef struct io_ring
+{
+    volatile uint32_t sq_head;
+    volatile uint32_t sq_tail;
+    volatile uint32_t cq_head;
+    volatile uint32_t cq_tail;
+    ring_sqe_t sq[RING_ENTRIES];
+    ring_cqe_t cq[RING_ENTRIES];
+} io_ring_t;
+
+// Defined in file_system.h, which includes this header first
+struct dentry;
+struct stat;
+
+file_descriptor_t *find_pcb(int32_t fd);
 
 /* command parser before executing */
 uint8_t parse_cmd(const uint8_t *args, uint8_t *parsed_cmd);
-int32_t exe_check(uint8_t *cmd, uint8_t *buffer);
+int32_t exe_check(uint8_t *cmd, struct dentry *dentry, uint8_t *header);
 void create_pcb(int8_t terminal_num);
 void map(uint32_t vaddr, uint32_t paddr);
-void load_exe_data(uint8_t *buffer, uint32_t length);
+void load_exe_data(uint32_t inode, uint32_t length);
 uint8_t parse_second_arg(const uint8_t *args);
 /* Switches the terminal */
 extern int32_t terminal_switch(int32_t terminal_num);
@@ -92,5 +192,24 @@ int32_t getargs(uint8_t *buf, int32_t nbytes);
 int32_t vidmap(uint8_t **screen_start);
 int32_t set_handler(int32_t signum, void *handler_address);
 int32_t sigreturn(void);
+int32_t getdents(int32_t fd, void *buf, int32_t nbytes);
+int32_t stat(const uint8_t *filename, struct stat *buf);
+int32_t fstat(int32_t fd, struct stat *buf);
+int32_t lseek(int32_t fd, int32_t offset, int32_t whence);
+int32_t pread(int32_t fd, void *buf, int32_t nbytes, int32_t offset);
+int32_t dup(int32_t fd);
+int32_t dup2(int32_t fd, int32_t new_fd);
+int32_t sysenter_init(void);
+int32_t readv(int32_t fd, const iovec_t *iov, int32_t iovcnt);
+int32_t writev(int32_t fd, const iovec_t *iov, int32_t iovcnt);
+int32_t ring_enter(io_ring_t *ring, int32_t to_submit);
+int32_t syscall_stats(int32_t which, syscall_stats_t *buf);
+int32_t poll(pollfd_t *fds, int32_t nfds, int32_t timeout);
+int32_t fcntl(int32_t fd, int32_t cmd, int32_t arg);
+int32_t time(uint32_t *seconds);
+// page_cache.h includes this header through lib.h, so only the tag is declared here
+struct page_cache_stats;
+int32_t cache_stats(struct page_cache_stats *buf);
+int32_t syscall_dispatch(uint32_t number, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4);
 
 #endif
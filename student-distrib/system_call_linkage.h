@@ -6,6 +6,8 @@
 
 extern void system_call_link(void);
 
+extern void sysenter_link(void);
+
 extern void switch_to_user(uint32_t);
 
 extern void flush_TLB(void);
@@ -446,20 +446,720 @@ int directory_write_test()
 int directory_read_test()
 {
 	TEST_HEADER;
-	unsigned int i;
-	for (i = 0; i < 62; i++)
+	create_pcb(0);
+	int32_t dir_fd = open((uint8_t *)".");
+	unsigned char buffer[32];
+	int32_t num;
+	while ((num = directory_read(dir_fd, buffer, 32)) != 0)
 	{
-		int temp = i;
-		unsigned char buffer[32];
-		if (directory_read(0, buffer, 0) == 0)
-		{
-			return PASS;
-		}
-		i = temp;
-		terminal_write(0, buffer, 32);
+		terminal_write(0, buffer, num);
 		buffer[0] = '\n';
 		terminal_write(0, buffer, 1);
 	}
+	close(dir_fd);
+	return PASS;
+}
+
+// test that getdents returns every root entry, with the same names read_dentry_by_index gives
+// Coverage: directory_getdents
+int getdents_test()
+{
+	TEST_HEADER;
+	uint32_t buffer[256];
+	dentry_t den;
+	int32_t num, pos;
+	uint32_t count = 0;
+	create_pcb(0);
+	int32_t dir_fd = open((uint8_t *)".");
+	while ((num = directory_getdents(dir_fd, buffer, sizeof(buffer))) > 0)
+	{
+		for (pos = 0; pos < num; pos += ((dirent_t *)((uint8_t *)buffer + pos))->record_length)
+		{
+			dirent_t *record = (dirent_t *)((uint8_t *)buffer + pos);
+			if (read_dentry_by_index(count, &den) == -1 || strncmp((int8_t *)record->name, (int8_t *)den.fileName, record->name_length + 1) != 0)
+			{
+				close(dir_fd);
+				return FAIL;
+			}
+			count++;
+		}
+	}
+	close(dir_fd);
+	// Every entry came back and nothing more
+	if (num == -1 || read_dentry_by_index(count, &den) != -1)
+	{
+		return FAIL;
+	}
+	return PASS;
+}
+
+// test that stat records match the directory entry and inode
+// Coverage: inode_stat
+int stat_test()
+{
+	TEST_HEADER;
+	stat_t info;
+	dentry_t den;
+	if (read_dentry_by_name((uint8_t *)"frame0.txt", &den) == -1 || inode_stat(den.inodeNum, den.fileType, &info) == -1)
+	{
+		return FAIL;
+	}
+	if (info.inode != den.inodeNum || info.type != REGULAR_FILE_TYPE || info.length != get_inode_length(den.inodeNum) ||
+		info.blocks != (info.length + FILE_MEMORY_BLOCK_SIZE - 1) / FILE_MEMORY_BLOCK_SIZE)
+	{
+		return FAIL;
+	}
+	// The RTC has no length
+	if (read_dentry_by_name((uint8_t *)"rtc", &den) == -1 || inode_stat(den.inodeNum, den.fileType, &info) == -1 ||
+		info.type != USER_LEVEL_FILE_TYPE || info.length != 0)
+	{
+		return FAIL;
+	}
+	return PASS;
+}
+
+// test that lseek moves the position and pread leaves it alone
+// Coverage: file_lseek, file_pread, directory_lseek
+int lseek_pread_test()
+{
+	TEST_HEADER;
+	uint8_t seek_buf[16];
+	uint8_t pread_buf[16];
+	int32_t length;
+	create_pcb(0);
+	int32_t fd = open((uint8_t *)"frame0.txt");
+	if (fd == -1)
+	{
+		return FAIL;
+	}
+	length = get_inode_length(find_pcb(fd)->inode);
+	// The last 16 bytes two ways
+	if (file_lseek(fd, -16, SEEK_END) != length - 16 || file_read(fd, seek_buf, 16) != 16 ||
+		file_pread(fd, pread_buf, 16, length - 16) != 16 || strncmp((int8_t *)seek_buf, (int8_t *)pread_buf, 16) != 0)
+	{
+		close(fd);
+		return FAIL;
+	}
+	// pread did not move the position, and there is nothing left to read
+	if (find_pcb(fd)->file_position != length || file_read(fd, seek_buf, 16) != 0 ||
+		file_lseek(fd, -1, SEEK_SET) != -1 || file_lseek(fd, 0, SEEK_CUR) != length)
+	{
+		close(fd);
+		return FAIL;
+	}
+	close(fd);
+	// Rewinding a directory starts the listing again
+	fd = open((uint8_t *)".");
+	if (directory_read(fd, seek_buf, 16) <= 0 || directory_lseek(fd, 0, SEEK_SET) != 0 ||
+		directory_lseek(fd, 0, SEEK_END) != -1 || find_pcb(fd)->file_position != 0)
+	{
+		close(fd);
+		return FAIL;
+	}
+	close(fd);
+	return PASS;
+}
+
+// test that small sequential reads through the fd cursor return the same bytes as read_data
+// Coverage: file_read, fs_read_data
+int read_cursor_test()
+{
+	TEST_HEADER;
+	uint8_t chunk[100];
+	uint8_t whole[100];
+	int32_t num, offset = 0;
+	create_pcb(0);
+	int32_t fd = open((uint8_t *)"fish");
+	if (fd == -1)
+	{
+		return FAIL;
+	}
+	while ((num = file_read(fd, chunk, sizeof(chunk))) > 0)
+	{
+		if (read_data(find_pcb(fd)->inode, offset, whole, num) != num || strncmp((int8_t *)chunk, (int8_t *)whole, num) != 0)
+		{
+			close(fd);
+			return FAIL;
+		}
+		offset += num;
+	}
+	// Every byte came back
+	if (num == -1 || offset != get_inode_length(find_pcb(fd)->inode))
+	{
+		close(fd);
+		return FAIL;
+	}
+	close(fd);
+	return PASS;
+}
+
+// test that dup and dup2 share one open file and that dup2 grows the fd table
+// Coverage: dup, dup2, close, find_pcb
+int dup_test()
+{
+	TEST_HEADER;
+	uint8_t buf[16];
+	create_pcb(0);
+	int32_t fd = open((uint8_t *)"frame0.txt");
+	int32_t copy = dup(fd);
+	if (fd == -1 || copy == -1 || copy == fd || find_pcb(copy) != find_pcb(fd))
+	{
+		return FAIL;
+	}
+	// Both descriptors move the same position
+	if (file_read(fd, buf, 16) != 16 || file_lseek(copy, 0, SEEK_CUR) != 16)
+	{
+		return FAIL;
+	}
+	// Past the 8 descriptors in the PCB
+	if (dup2(copy, 20) != 20 || find_pcb(20) != find_pcb(copy) || find_pcb(20)->refcount != 3)
+	{
+		return FAIL;
+	}
+	// The open file outlives the descriptor it was opened with
+	close(fd);
+	if (find_pcb(fd) != 0 || file_read(20, buf, 16) != 16 || file_lseek(copy, 0, SEEK_CUR) != 32)
+	{
+		return FAIL;
+	}
+	close(copy);
+	close(20);
+	if (find_pcb(20) != 0 || dup(fd) != -1 || dup2(1, -1) != -1)
+	{
+		return FAIL;
+	}
+	return PASS;
+}
+
+// test that registered devices open through their shared tables, with or without an entry in the image
+// Coverage: vfs_resolve, vfs_register_device, vfs_find_device, open
+int vfs_device_test()
+{
+	TEST_HEADER;
+	uint8_t buf[16];
+	stat_t info;
+	int32_t i;
+	create_pcb(0);
+	int32_t null_fd = open((uint8_t *)"null");
+	int32_t zero_fd = open((uint8_t *)"zero");
+	int32_t rtc_fd = open((uint8_t *)"rtc");
+	if (null_fd == -1 || zero_fd == -1 || rtc_fd == -1 || find_pcb(rtc_fd)->file_operations_table_ptr != vfs_find_device((uint8_t *)"rtc"))
+	{
+		return FAIL;
+	}
+	memset(buf, 1, sizeof(buf));
+	if (read(null_fd, buf, sizeof(buf)) != 0 || write(null_fd, buf, sizeof(buf)) != sizeof(buf) ||
+		read(zero_fd, buf, sizeof(buf)) != sizeof(buf) || lseek(zero_fd, 0, SEEK_SET) != -1)
+	{
+		return FAIL;
+	}
+	for (i = 0; i < sizeof(buf); i++)
+	{
+		if (buf[i] != 0)
+		{
+			return FAIL;
+		}
+	}
+	// Devices are type 0 with no length; a name can only be taken once
+	if (find_pcb(zero_fd)->file_operations_table_ptr->fstat(zero_fd, &info) != 0 || info.type != USER_LEVEL_FILE_TYPE ||
+		info.length != 0 || vfs_register_device((int8_t *)"null", find_pcb(zero_fd)->file_operations_table_ptr) != -1)
+	{
+		return FAIL;
+	}
+	close(null_fd);
+	close(zero_fd);
+	close(rtc_fd);
+	if (open((uint8_t *)"nosuchdevice") != -1)
+	{
+		return FAIL;
+	}
+	return PASS;
+}
+
+// test that readv and writev refuse buffers outside the program's page before touching the fd
+// Coverage: readv, writev
+int readv_writev_test()
+{
+	TEST_HEADER;
+	uint8_t buf[16];
+	iovec_t iov[IOV_MAX + 1];
+	create_pcb(0);
+	int32_t fd = open((uint8_t *)"frame0.txt");
+	iov[0].base = buf;
+	iov[0].length = sizeof(buf);
+	// Kernel buffers, no buffers, too many buffers, and a file that cannot be written
+	if (fd == -1 || readv(fd, iov, 1) != -1 || readv(fd, iov, 0) != -1 || writev(1, iov, IOV_MAX + 1) != -1 ||
+		writev(fd, NULL, 1) != -1 || find_pcb(fd)->file_position != 0)
+	{
+		return FAIL;
+	}
+	close(fd);
+	return PASS;
+}
+
+// test that ring_enter leaves a ring outside the program's page untouched
+// Coverage: ring_enter
+int ring_enter_test()
+{
+	TEST_HEADER;
+	static io_ring_t ring;
+	memset(&ring, 0, sizeof(ring));
+	ring.sq[0].opcode = RING_OP_CLOSE;
+	ring.sq[0].fd = 2;
+	ring.sq_tail = 1;
+	if (ring_enter(&ring, 0) != -1 || ring_enter(NULL, 1) != -1 || ring.sq_head != 0 || ring.cq_tail != 0)
+	{
+		return FAIL;
+	}
+	return PASS;
+}
+
+// test that poll rejects a kernel address array and a bad count without touching them
+// Coverage: poll
+int poll_test()
+{
+	TEST_HEADER;
+	static pollfd_t fds[1];
+	fds[0].fd = 0;
+	fds[0].events = POLLIN;
+	fds[0].revents = 0;
+	if (poll(fds, 1, 0) != -1 || poll(fds, 0, 0) != -1 || poll(fds, POLL_MAX_FDS + 1, 0) != -1 || poll(NULL, 1, 0) != -1)
+	{
+		return FAIL;
+	}
+	if (fds[0].revents != 0)
+	{
+		return FAIL;
+	}
+	return PASS;
+}
+
+// test that an O_NONBLOCK RTC read returns at once when no tick is due, and that fcntl checks its flags
+// Coverage: fcntl, read, rtc_poll
+int nonblock_read_test()
+{
+	TEST_HEADER;
+	int32_t garbage;
+	int32_t fd = open((uint8_t *)"rtc");
+	if (fd == -1 || fcntl(fd, F_GETFL, 0) != 0 || fcntl(fd, F_SETFL, 0x100) != -1 || fcntl(fd, 99, 0) != -1)
+	{
+		return FAIL;
+	}
+	// Opening restarts the virtual count, so the 2 Hz tick is half a second away
+	if (fcntl(fd, F_SETFL, O_NONBLOCK) != 0 || fcntl(fd, F_GETFL, 0) != O_NONBLOCK || read(fd, &garbage, 4) != WOULD_BLOCK)
+	{
+		close(fd);
+		return FAIL;
+	}
+	close(fd);
+	return PASS;
+}
+
+// test that each open of the RTC keeps its own rate, so one file speeding up leaves another alone
+// Coverage: rtc_open, rtc_write, rtc_read, rtc_close
+int rtc_rate_test()
+{
+	TEST_HEADER;
+	uint32_t freq = FREQ_UPPER_LIMIT;
+	int32_t fast = open((uint8_t *)"rtc");
+	int32_t slow = open((uint8_t *)"rtc");
+	int32_t result = PASS;
+	if (fast == -1 || slow == -1 || write(fast, &freq, 4) != 0)
+	{
+		result = FAIL;
+	}
+	// The slow file starts at 2 Hz the first time it is used; a read of the fast one waits at most 1/1024 s
+	else if (find_pcb(fast)->rtc_period != 1 || rtc_read(fast, 0, 0) < 0 || fcntl(slow, F_SETFL, O_NONBLOCK) != 0 ||
+			 read(slow, &freq, 4) != WOULD_BLOCK || find_pcb(slow)->rtc_period != PERIOD_INIT)
+	{
+		result = FAIL;
+	}
+	close(fast);
+	close(slow);
+	return result;
+}
+
+// test that time refuses kernel addresses and that the cached clock is past 2000 and not going back
+// Coverage: time, wall_clock_now
+int wall_clock_test()
+{
+	TEST_HEADER;
+	static uint32_t seconds;
+	uint32_t first = wall_clock_now();
+	if (time(&seconds) != -1 || time(NULL) != -1)
+	{
+		return FAIL;
+	}
+	// 2000-01-01 00:00 UTC
+	if (first < 946684800 || wall_clock_now() < first)
+	{
+		return FAIL;
+	}
+	return PASS;
+}
+
+// test that printing a buffer at once leaves the same screen and cursor as a putc per byte
+// Coverage: putbuf, putc, vert_scroll
+int putbuf_test()
+{
+	TEST_HEADER;
+	static uint8_t text[2000];
+	// 80 by 25 text cells, a character and an attribute byte each
+	static uint8_t screen[80 * 25 * 2];
+	int32_t x, y, i, count = 0;
+	for (i = 0; i < 2000; i++)
+	{
+		// Rows of different lengths, tabs, NULs and lines longer than the screen, so it scrolls
+		text[i] = (i % 97 == 96) ? '\n' : (i % 31 == 30) ? '\t' : (i % 53 == 52) ? '\0' : 'a' + i % 26;
+	}
+	clear();
+	for (i = 0; i < 2000; i++)
+	{
+		putc(text[i]);
+		count += (text[i] != '\0');
+	}
+	memcpy(screen, (uint8_t *)video_mem, sizeof(screen));
+	x = terminals[current_terminal_run].screen_x;
+	y = terminals[current_terminal_run].screen_y;
+	clear();
+	if (putbuf(text, 2000) != count || terminals[current_terminal_run].screen_x != x || terminals[current_terminal_run].screen_y != y)
+	{
+		return FAIL;
+	}
+	for (i = 0; i < sizeof(screen); i += 2)
+	{
+		if (screen[i] != (uint8_t)video_mem[i])
+		{
+			return FAIL;
+		}
+	}
+	clear();
+	return PASS;
+}
+
+// test that switching terminals only moves the display, leaving every terminal's page as it was
+// Coverage: terminal_switch, set_display_start
+int page_flip_test()
+{
+	TEST_HEADER;
+	uint8_t *page0 = (uint8_t *)terminal_address[0];
+	uint8_t *page1 = (uint8_t *)terminal_address[1];
+	uint8_t saved0 = page0[0], saved1 = page1[0];
+	int32_t result = PASS;
+	if (current_terminal_view != 0)
+	{
+		return FAIL;
+	}
+	page0[0] = 'A';
+	page1[0] = 'B';
+	if (terminal_switch(1) != 0 || current_terminal_view != 1)
+	{
+		result = FAIL;
+	}
+	// Nothing was copied into or out of the page that is now on screen
+	if (page0[0] != 'A' || page1[0] != 'B')
+	{
+		result = FAIL;
+	}
+	if (terminal_switch(0) != 0 || page0[0] != 'A' || page1[0] != 'B')
+	{
+		result = FAIL;
+	}
+	page0[0] = saved0;
+	page1[0] = saved1;
+	return result;
+}
+
+// test that scrolling moves the screen down the video region, and only copies when it wraps
+// Coverage: scroll_terminal, home_terminal, terminal_screen
+int scroll_ring_test()
+{
+	TEST_HEADER;
+	int32_t t = current_terminal_run, last, i;
+	uint16_t marker = 'M' | (0x7 << 8);
+	uint16_t *row;
+	home_terminal(t);
+	clear();
+	do
+	{
+		last = terminals[t].top_row;
+		// Mark the last row, which is one row from the bottom after the scroll
+		row = (uint16_t *)terminal_screen(t) + 24 * 80;
+		*row = marker;
+		scroll_terminal(t, 1);
+		if (terminals[t].top_row > last && (row != (uint16_t *)terminal_screen(t) + 23 * 80 || (char *)video_mem != terminal_screen(t)))
+		{
+			return FAIL;
+		}
+	} while (terminals[t].top_row > last);
+	// The region wrapped, so the rows that stayed were copied to its start
+	row = (uint16_t *)terminal_screen(t);
+	if (terminals[t].top_row != 0 || row != (uint16_t *)terminal_address[t] || row[23 * 80] != marker)
+	{
+		return FAIL;
+	}
+	for (i = 24 * 80; i < 25 * 80; i++)
+	{
+		if (row[i] != (' ' | (0x7 << 8)))
+		{
+			return FAIL;
+		}
+	}
+	clear();
+	return PASS;
+}
+
+// test that a vidmapped screen scrolls in place at the start of the region
+// Coverage: scroll_terminal, vidmap_pid
+int vidmap_scroll_test()
+{
+	TEST_HEADER;
+	int32_t t = current_terminal_run, saved = terminals[t].vidmap_pid;
+	uint16_t marker = 'V' | (0x7 << 8);
+	uint16_t *row = (uint16_t *)terminal_address[t];
+	int32_t result = PASS;
+	home_terminal(t);
+	clear();
+	terminals[t].vidmap_pid = terminals[t].current_pid;
+	row[24 * 80] = marker;
+	scroll_terminal(t, 1);
+	if (terminals[t].top_row != 0 || terminal_screen(t) != (char *)row || row[23 * 80] != marker || row[24 * 80] != (' ' | (0x7 << 8)))
+	{
+		result = FAIL;
+	}
+	terminals[t].vidmap_pid = saved;
+	clear();
+	return result;
+}
+
+// test that lines scrolled off the screen, even ones never drawn, can be paged back to
+// Coverage: scroll_terminal, putbuf, scrollback_page, scrollback_reset
+int scrollback_test()
+{
+	TEST_HEADER;
+	static uint8_t text[60];
+	uint16_t *page = (uint16_t *)SCROLLBACK_VIDEO;
+	int32_t t = current_terminal_view, i, back, result = PASS;
+	if (current_terminal_run != t)
+	{
+		return FAIL;
+	}
+	// 30 one letter lines from the top of a clear screen, so 6 scroll off in one write
+	clear();
+	terminals[t].screen_x = 0;
+	terminals[t].screen_y = 0;
+	for (i = 0; i < 30; i++)
+	{
+		text[i << 1] = 'a' + i;
+		text[(i << 1) + 1] = '\n';
+	}
+	putbuf(text, 60);
+	// A page back, or less if the scrollback is shorter, with a to f just above the live screen
+	back = (terminals[t].scrollback_rows < 25) ? terminals[t].scrollback_rows : 25;
+	scrollback_page(1);
+	for (i = 0; i < 6; i++)
+	{
+		if ((uint8_t)page[(back - 6 + i) * 80] != 'a' + i)
+		{
+			result = FAIL;
+		}
+	}
+	if (back < 25 && (uint8_t)page[back * 80] != 'g')
+	{
+		result = FAIL;
+	}
+	// Paging forward twice goes back to the live screen and stays there, leaving the page alone
+	scrollback_page(-1);
+	page[0] = 'Z' | (0x4F << 8);
+	scrollback_page(-1);
+	if (page[0] != ('Z' | (0x4F << 8)))
+	{
+		result = FAIL;
+	}
+	scrollback_reset();
+	clear();
+	return result;
+}
+
+// test that the jump table has an entry for every system call number
+// Coverage: jump_table, NUM_SYSCALLS
+int jump_table_test()
+{
+	TEST_HEADER;
+	// Defined in system_call_linkage.S, which checks the length against MAX_SYSCALL
+	extern uint32_t jump_table[], jump_table_end[];
+	int32_t i;
+	if (jump_table_end - jump_table != NUM_SYSCALLS)
+	{
+		return FAIL;
+	}
+	// 0 is the only unused number
+	for (i = 1; i < NUM_SYSCALLS; i++)
+	{
+		if (jump_table[i] == 0)
+		{
+			return FAIL;
+		}
+	}
+	return PASS;
+}
+
+// test that names longer than 32 chars and paths resolve on a version 2 image
+// Coverage: read_dentry_by_name, read_dentry_in_directory
+int long_name_lookup_test()
+{
+	TEST_HEADER;
+	dentry_t den;
+	if (fs_version != FS_VERSION_2)
+	{
+		return PASS;
+	}
+	if (read_dentry_by_name((uint8_t *)"verylargetextwithverylongname.txt", &den) == -1 || den.fileType != REGULAR_FILE_TYPE)
+	{
+		return FAIL;
+	}
+	if (read_dentry_by_name((uint8_t *)"./frame0.txt", &den) == -1 || den.fileType != REGULAR_FILE_TYPE)
+	{
+		return FAIL;
+	}
+	if (read_dentry_by_name((uint8_t *)"frame0.txt/frame0.txt", &den) != -1)
+	{
+		return FAIL;
+	}
+	return PASS;
+}
+
+// test reading the filesystem disk: sector 0 holds the same block 0 that was mounted
+// Coverage: ata_read_sectors (run with "-hdb filesys_img")
+int ata_read_test()
+{
+	TEST_HEADER;
+	uint32_t sector[ATA_SECTOR_SIZE / 4];
+	int i;
+	if (ata_sector_count() == 0)
+	{
+		return PASS;
+	}
+	if (ata_read_sectors(0, 1, sector) != 1)
+	{
+		return FAIL;
+	}
+	for (i = 0; i < ATA_SECTOR_SIZE / 4; i++)
+	{
+		if (sector[i] != ((uint32_t *)global_boot_block_t)[i])
+		{
+			return FAIL;
+		}
+	}
+	// Reads past the end of the disk are refused
+	if (ata_read_sectors(ata_sector_count(), 1, sector) != -1)
+	{
+		return FAIL;
+	}
+	return PASS;
+}
+
+// test that two adjacent requests queued together read the same data as one request
+// Coverage: ata_submit merging, ata_wait_request (run with "-hdb filesys_img")
+int ata_merge_test()
+{
+	TEST_HEADER;
+	uint32_t whole[ATA_SECTOR_SIZE / 2];
+	uint32_t halves[ATA_SECTOR_SIZE / 2];
+	ata_request_t first, second;
+	int i;
+	if (ata_sector_count() < 2)
+	{
+		return PASS;
+	}
+	if (ata_read_sectors(0, 2, whole) != 2)
+	{
+		return FAIL;
+	}
+	// Queue the second half first; the elevator still reads them in one command
+	second.lba = 1;
+	second.count = 1;
+	second.buf = halves + ATA_SECTOR_SIZE / 4;
+	first.lba = 0;
+	first.count = 1;
+	first.buf = halves;
+	ata_plug();
+	if (ata_submit(&second) == -1 || ata_submit(&first) == -1)
+	{
+		ata_unplug();
+		return FAIL;
+	}
+	ata_unplug();
+	if (ata_wait_request(&first) != 1 || ata_wait_request(&second) != 1)
+	{
+		return FAIL;
+	}
+	for (i = 0; i < ATA_SECTOR_SIZE / 2; i++)
+	{
+		if (whole[i] != halves[i])
+		{
+			return FAIL;
+		}
+	}
+	return PASS;
+}
+
+// test that reading a file a second time is served from the page cache, and print the counters
+// Coverage: page_cache_get, read_data (only counts when mounted from the ATA disk)
+int page_cache_test()
+{
+	TEST_HEADER;
+	dentry_t den;
+	uint8_t buffer[FILE_MEMORY_BLOCK_SIZE];
+	page_cache_stats_t before, after;
+	uint32_t offset;
+	int32_t num;
+	if (read_dentry_by_name((uint8_t *)"frame0.txt", &den) == -1)
+	{
+		return FAIL;
+	}
+	for (offset = 0; (num = read_data(den.inodeNum, offset, buffer, sizeof(buffer))) > 0; offset += num)
+		;
+	page_cache_get_stats(&before);
+	for (offset = 0; (num = read_data(den.inodeNum, offset, buffer, sizeof(buffer))) > 0; offset += num)
+		;
+	page_cache_get_stats(&after);
+	printf("page cache: %d hits, %d misses, %d read ahead, %d evicted\n", after.hits, after.misses, after.readaheads, after.evictions);
+	if (num == -1 || after.misses != before.misses)
+	{
+		return FAIL;
+	}
+	return PASS;
+}
+
+// test that a compressed image is decompressed once and then read from the block cache
+// Coverage: read_data, fs_get_block, lz4_decompress
+int compressed_read_test()
+{
+	TEST_HEADER;
+	dentry_t den;
+	uint8_t buffer[FILE_MEMORY_BLOCK_SIZE];
+	fs_compress_stats_t before, after;
+	uint32_t offset;
+	int32_t num;
+	if (read_dentry_by_name((uint8_t *)"shell", &den) == -1)
+	{
+		return FAIL;
+	}
+	for (offset = 0; (num = read_data(den.inodeNum, offset, buffer, sizeof(buffer))) > 0; offset += num)
+		;
+	file_system_get_compress_stats(&before);
+	for (offset = 0; (num = read_data(den.inodeNum, offset, buffer, sizeof(buffer))) > 0; offset += num)
+		;
+	file_system_get_compress_stats(&after);
+	// The low 32 bits are plenty for a handful of blocks
+	printf("compressed image: %d blocks decompressed, %d cache hits, %d cycles per block\n", after.decompressed, after.cache_hits,
+		   after.decompressed ? (uint32_t)after.decompress_cycles / after.decompressed : 0);
+	// shell is only a couple of blocks, so the second pass never decompresses
+	if (num == -1 || offset != get_inode_length(den.inodeNum) || after.decompressed != before.decompressed)
+	{
+		return FAIL;
+	}
 	return PASS;
 }
 
@@ -526,9 +1226,10 @@ int parse_cmd_test()
 int exe_check_test_fail()
 {
 	TEST_HEADER;
-	uint8_t buffer[10000];
+	uint8_t buffer[EXE_HEADER_SIZE];
+	dentry_t den;
 	int8_t *cmd = "frame0.txt";
-	if (exe_check((uint8_t *)cmd, buffer) == -1)
+	if (exe_check((uint8_t *)cmd, &den, buffer) == -1)
 	{
 		return PASS;
 	}
@@ -539,9 +1240,10 @@ int exe_check_test_fail()
 int exe_check_test_pass()
 {
 	TEST_HEADER;
-	uint8_t buffer[10000];
+	uint8_t buffer[EXE_HEADER_SIZE];
+	dentry_t den;
 	int8_t *cmd = "shell";
-	if (exe_check((uint8_t *)cmd, buffer) > 0)
+	if (exe_check((uint8_t *)cmd, &den, buffer) == get_inode_length(den.inodeNum))
 	{
 		return PASS;
 	}
@@ -709,6 +1411,29 @@ void launch_tests()
 
 	/*FILE TEST*/
 	// TEST_OUTPUT("print the directory list", directory_read_test());
+	// TEST_OUTPUT("long name lookup", long_name_lookup_test());
+	// TEST_OUTPUT("getdents", getdents_test());
+	// TEST_OUTPUT("stat", stat_test());
+	// TEST_OUTPUT("lseek and pread", lseek_pread_test());
+	// TEST_OUTPUT("read cursor", read_cursor_test());
+	// TEST_OUTPUT("dup and dup2", dup_test());
+	// TEST_OUTPUT("vfs devices", vfs_device_test());
+	// TEST_OUTPUT("readv and writev", readv_writev_test());
+	// TEST_OUTPUT("ring enter", ring_enter_test());
+	// TEST_OUTPUT("poll", poll_test());
+	// TEST_OUTPUT("nonblocking read", nonblock_read_test());
+	// TEST_OUTPUT("rtc rate", rtc_rate_test());
+	// TEST_OUTPUT("wall clock", wall_clock_test());
+	// TEST_OUTPUT("jump table", jump_table_test());
+	// TEST_OUTPUT("putbuf", putbuf_test());
+	// TEST_OUTPUT("page_flip", page_flip_test());
+	// TEST_OUTPUT("scroll ring", scroll_ring_test());
+	// TEST_OUTPUT("vidmap scroll", vidmap_scroll_test());
+	// TEST_OUTPUT("scrollback", scrollback_test());
+	// TEST_OUTPUT("ata read", ata_read_test());
+	// TEST_OUTPUT("ata merge", ata_merge_test());
+	// TEST_OUTPUT("page cache", page_cache_test());
+	// TEST_OUTPUT("compressed image", compressed_read_test());
 	// TEST_OUTPUT("print the file list", file_read_test1());
 	// TEST_OUTPUT("print the file list2", file_read_test2());
 	// TEST_OUTPUT("test file_open", file_open_test());
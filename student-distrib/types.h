@@ -8,10 +8,14 @@
 #define _TYPES_H
 
 #define NULL 0
+#define INT32_MAX 0x7FFFFFFF
 
 #ifndef ASM
 
 /* Types defined here just like in <stdint.h> */
+typedef long long int64_t;
+typedef unsigned long long uint64_t;
+
 typedef int int32_t;
 typedef unsigned int uint32_t;
 
@@ -0,0 +1,178 @@
+#include "vfs.h"
+#include "lib.h"
+#include "file_system.h"
+
+// Devices drivers have attached, in the order they registered
+static vfs_device_t vfs_devices[VFS_MAX_DEVICES];
+static uint32_t vfs_num_devices;
+
+/**
+ * @brief Open and close of a device with nothing to set up
+ *
+ * @return 0
+ */
+static int32_t null_open(const uint8_t *filename)
+{
+	return 0;
+}
+
+static int32_t null_close(int32_t fd)
+{
+	return 0;
+}
+
+/**
+ * @brief Reads from null, which is always at end of file
+ *
+ * @return 0
+ */
+static int32_t null_read(int32_t fd, void *buf, int32_t nbytes)
+{
+	return 0;
+}
+
+/**
+ * @brief Writes to null or zero, which throw the bytes away
+ *
+ * @return nbytes, as if all were written
+ */
+static int32_t null_write(int32_t fd, const void *buf, int32_t nbytes)
+{
+	return (nbytes < 0) ? -1 : nbytes;
+}
+
+/**
+ * @brief Reads from zero, which never runs out of zero bytes
+ *
+ * @param buf Buffer to fill
+ * @param nbytes Length of buffer
+ * @return nbytes, -1 for fail
+ */
+static int32_t zero_read(int32_t fd, void *buf, int32_t nbytes)
+{
+	if (buf == NULL || nbytes < 0)
+	{
+		return -1;
+	}
+	memset(buf, 0, nbytes);
+	return nbytes;
+}
+
+static const file_operations_table_t null_table = {
+	.open = null_open,
+	.close = null_close,
+	.read = null_read,
+	.write = null_write,
+	.fstat = vfs_device_fstat,
+};
+
+static const file_operations_table_t zero_table = {
+	.open = null_open,
+	.close = null_close,
+	.read = zero_read,
+	.write = null_write,
+	.fstat = vfs_device_fstat,
+};
+
+/**
+ * @brief Attaches the built-in null and zero devices
+ */
+void vfs_init(void)
+{
+	vfs_register_device((int8_t *)"null", &null_table);
+	vfs_register_device((int8_t *)"zero", &zero_table);
+}
+
+/**
+ * @brief Attaches a driver's operations under a device name
+ *        (Device entries in the filesystem with that name open through them)
+ *
+ * @param name Device name
+ * @param ops Driver's operations, which must stay valid for as long as the kernel runs
+ * @return 0 for success, -1 if the name is too long, taken, or the registry is full
+ */
+int32_t vfs_register_device(const int8_t *name, const file_operations_table_t *ops)
+{
+	uint32_t length = strlen(name);
+	if (ops == NULL || length == 0 || length >= VFS_DEVICE_NAME_LENGTH || vfs_num_devices == VFS_MAX_DEVICES ||
+		vfs_find_device((const uint8_t *)name) != NULL)
+	{
+		return -1;
+	}
+	strcpy(vfs_devices[vfs_num_devices].name, name);
+	vfs_devices[vfs_num_devices].ops = ops;
+	vfs_num_devices++;
+	return 0;
+}
+
+/**
+ * @brief Finds a registered device by name
+ *
+ * @param name Device name
+ * @return The device's operations, 0 if no driver has that name
+ */
+const file_operations_table_t *vfs_find_device(const uint8_t *name)
+{
+	uint32_t i;
+	for (i = 0; i < vfs_num_devices; i++)
+	{
+		if (strncmp(vfs_devices[i].name, (const int8_t *)name, VFS_DEVICE_NAME_LENGTH) == 0)
+		{
+			return vfs_devices[i].ops;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Looks up what open() gives a name: a file, a directory, or the driver of a device entry
+ *        (A registered device with no entry in the image still opens by its name)
+ *
+ * @param filename Name of a file (or path)
+ * @param inode Set to the inode of a file or directory, 0 for a device
+ * @return The operations for the new open file, 0 if there is nothing by that name
+ */
+const file_operations_table_t *vfs_resolve(const uint8_t *filename, uint32_t *inode)
+{
+	dentry_t den;
+	*inode = 0;
+	if (read_dentry_by_name(filename, &den) == -1)
+	{
+		return vfs_find_device(filename);
+	}
+	switch (den.fileType)
+	{
+	case USER_LEVEL_FILE_TYPE:
+		return vfs_find_device(den.fileName);
+	case DIRECTORY_FILE_TYPE:
+		*inode = den.inodeNum;
+		return &directory_table;
+	case REGULAR_FILE_TYPE:
+		*inode = den.inodeNum;
+		return &file_table;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * @brief Wakes everything sleeping on a queue; safe to call from an interrupt handler
+ *
+ * @param queue Queue to wake
+ */
+void wait_queue_wake(wait_queue_t *queue)
+{
+	queue->wakeups++;
+}
+
+/**
+ * @brief Stat record of an open device: type 0 and no length
+ *
+ * @param fd Index
+ * @param info Stat record to fill
+ * @return 0 for success, -1 for fail
+ */
+int32_t vfs_device_fstat(int32_t fd, stat_t *info)
+{
+	return inode_stat(0, USER_LEVEL_FILE_TYPE, info);
+}
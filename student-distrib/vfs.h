@@ -0,0 +1,65 @@
+#ifndef VFS_H
+#define VFS_H
+
+#include "types.h"
+
+#define VFS_MAX_DEVICES 8		  // Device nodes drivers can attach
+#define VFS_DEVICE_NAME_LENGTH 16 // Longest device name, with its terminating NUL
+
+// Events for poll
+#define POLLIN 0x01	  // A read would not block
+#define POLLOUT 0x04  // A write would not block
+#define POLLNVAL 0x20 // Not an open descriptor (always reported)
+#define POLL_MAX_FDS 16
+
+struct stat;
+
+/* Something a sleeper can wait on; waking counts up so a wake between checking and sleeping is not lost */
+typedef struct wait_queue
+{
+	volatile uint32_t wakeups;
+} wait_queue_t;
+
+/* Operations of one kind of open file; every table is const and shared by all its opens.
+ * An operation the kind does not support is 0, and its system call fails with -1 */
+typedef struct file_operations_table
+{
+	int32_t (*open)(const uint8_t *filename);
+	int32_t (*close)(int32_t fd);
+	int32_t (*read)(int32_t fd, void *buf, int32_t nbytes);
+	int32_t (*write)(int32_t fd, const void *buf, int32_t nbytes);
+	int32_t (*getdents)(int32_t fd, void *buf, int32_t nbytes);
+	int32_t (*lseek)(int32_t fd, int32_t offset, int32_t whence);
+	int32_t (*pread)(int32_t fd, void *buf, int32_t nbytes, uint32_t offset);
+	int32_t (*fstat)(int32_t fd, struct stat *info);
+	// Events ready now; *queue is set to what is woken when that may change (0 if it never does).
+	// Without it, a table is ready for whichever of read and write it has
+	uint32_t (*poll)(int32_t fd, wait_queue_t **queue);
+} file_operations_table_t;
+
+/* Device node a driver has attached */
+typedef struct vfs_device
+{
+	int8_t name[VFS_DEVICE_NAME_LENGTH];
+	const file_operations_table_t *ops;
+} vfs_device_t;
+
+/* Attaches the built-in null and zero devices */
+extern void vfs_init(void);
+
+/* Attaches a driver's operations under a device name */
+extern int32_t vfs_register_device(const int8_t *name, const file_operations_table_t *ops);
+
+/* Operations of a registered device, 0 if no driver has that name */
+extern const file_operations_table_t *vfs_find_device(const uint8_t *name);
+
+/* Operations and inode that open() gives a file, directory or device */
+extern const file_operations_table_t *vfs_resolve(const uint8_t *filename, uint32_t *inode);
+
+/* Wakes everything sleeping on a queue */
+extern void wait_queue_wake(wait_queue_t *queue);
+
+/* Stat record shared by every device (type 0, no length) */
+extern int32_t vfs_device_fstat(int32_t fd, struct stat *info);
+
+#endif
@@ -7,6 +7,8 @@ int main()
 {
     int32_t fd, cnt;
     uint8_t buf[1024];
+    struct ece391_stat st;
+    uint32_t left = 0xFFFFFFFF;
 
     if (0 != ece391_getargs(buf, 1024))
     {
@@ -20,7 +22,11 @@ int main()
         return 2;
     }
 
-    while (0 != (cnt = ece391_read(fd, buf, 1024)))
+    /* A regular file stops at its length, without a read just to see EOF */
+    if (0 == ece391_fstat(fd, &st) && 2 == st.type)
+        left = st.length;
+
+    while (0 != left && 0 != (cnt = ece391_read(fd, buf, left < 1024 ? left : 1024)))
     {
         if (-1 == cnt)
         {
@@ -29,6 +35,8 @@ int main()
         }
         if (-1 == ece391_write(1, buf, cnt))
             return 3;
+        if (0xFFFFFFFF != left)
+            left -= cnt;
     }
 
     return 0;
@@ -1,9 +1,13 @@
 #include <dirent.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
 #include <sys/mman.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "ece391support.h"
@@ -11,6 +15,9 @@
 #include "ece391sysnum.h"
 
 static uint32_t start_esp;
+
+/* There is no SYSENTER path when running on the host */
+int32_t ece391_fast_syscall = 0;
 static int32_t dir_fd = -1;
 static DIR *dir = NULL;
 
@@ -196,7 +203,13 @@ ece391_read(int32_t fd, void *buf, int32_t nbytes)
     uint8_t *to;
 
     if (NULL == dir || dir_fd != fd)
-        return __ece391_read(fd, buf, nbytes);
+    {
+        copied = __ece391_read(fd, buf, nbytes);
+        /* EAGAIN comes back as a plain failure */
+        if (-1 == copied && (fcntl(fd, F_GETFL) & O_NONBLOCK))
+            return ECE391_WOULD_BLOCK;
+        return copied;
+    }
     if (NULL == (de = readdir(dir)))
         return 0;
     to = buf;
@@ -218,6 +231,50 @@ ece391_read(int32_t fd, void *buf, int32_t nbytes)
     return copied;
 }
 
+int32_t
+ece391_getdents(int32_t fd, void *buf, int32_t nbytes)
+{
+    struct dirent *de;
+    struct stat st;
+    struct ece391_dirent *rec;
+    int32_t used, namelen, reclen;
+    long where;
+
+    if (NULL == dir || dir_fd != fd)
+        return -1;
+    used = 0;
+    while (1)
+    {
+        where = telldir(dir);
+        if (NULL == (de = readdir(dir)))
+            break;
+        namelen = ece391_strlen((uint8_t *)de->d_name);
+        reclen = (sizeof(*rec) + namelen + 1 + 3) & ~3;
+        if (used + reclen > nbytes)
+        {
+            /* leave the entry for the next call */
+            seekdir(dir, where);
+            if (0 == used)
+                return -1;
+            break;
+        }
+        rec = (struct ece391_dirent *)((uint8_t *)buf + used);
+        rec->inode = de->d_ino;
+        rec->type = 2;
+        rec->length = 0;
+        if (0 == stat(de->d_name, &st))
+        {
+            rec->type = S_ISDIR(st.st_mode) ? 1 : 2;
+            rec->length = st.st_size;
+        }
+        rec->reclen = reclen;
+        rec->namelen = namelen;
+        ece391_strcpy(rec->name, (uint8_t *)de->d_name);
+        used += reclen;
+    }
+    return used;
+}
+
 int32_t
 ece391_write(int32_t fd, const void *buf, int32_t nbytes)
 {
@@ -237,3 +294,195 @@ ece391_close(int32_t fd)
     dir_fd = -1;
     return 0;
 }
+
+static void
+fill_stat(const struct stat *st, struct ece391_stat *buf)
+{
+    buf->inode = st->st_ino;
+    buf->type = S_ISDIR(st->st_mode) ? 1 : 2;
+    buf->length = st->st_size;
+    buf->blocks = (st->st_size + 4095) / 4096;
+}
+
+int32_t
+ece391_stat(const uint8_t *filename, struct ece391_stat *buf)
+{
+    struct stat st;
+
+    if (0 != stat((const char *)filename, &st))
+        return -1;
+    fill_stat(&st, buf);
+    return 0;
+}
+
+int32_t
+ece391_fstat(int32_t fd, struct ece391_stat *buf)
+{
+    struct stat st;
+
+    if (2 > fd || 0 != fstat(fd, &st))
+        return -1;
+    fill_stat(&st, buf);
+    return 0;
+}
+
+int32_t
+ece391_lseek(int32_t fd, int32_t offset, int32_t whence)
+{
+    return lseek(fd, offset, whence);
+}
+
+int32_t
+ece391_pread(int32_t fd, void *buf, int32_t nbytes, int32_t offset)
+{
+    return pread(fd, buf, nbytes, offset);
+}
+
+int32_t
+ece391_dup(int32_t fd)
+{
+    return dup(fd);
+}
+
+int32_t
+ece391_dup2(int32_t fd, int32_t new_fd)
+{
+    return dup2(fd, new_fd);
+}
+
+/* Copies the buffers into the host's iovec layout */
+static int32_t
+to_host_iovec(const struct ece391_iovec *iov, int32_t iovcnt, struct iovec *host)
+{
+    int32_t i;
+
+    if (0 >= iovcnt || ECE391_IOV_MAX < iovcnt)
+        return -1;
+    for (i = 0; i < iovcnt; i++)
+    {
+        host[i].iov_base = iov[i].base;
+        host[i].iov_len = iov[i].length;
+    }
+    return 0;
+}
+
+int32_t
+ece391_readv(int32_t fd, const struct ece391_iovec *iov, int32_t iovcnt)
+{
+    struct iovec host[ECE391_IOV_MAX];
+
+    if (0 != to_host_iovec(iov, iovcnt, host))
+        return -1;
+    return readv(fd, host, iovcnt);
+}
+
+int32_t
+ece391_writev(int32_t fd, const struct ece391_iovec *iov, int32_t iovcnt)
+{
+    struct iovec host[ECE391_IOV_MAX];
+
+    if (0 != to_host_iovec(iov, iovcnt, host))
+        return -1;
+    return writev(fd, host, iovcnt);
+}
+
+/* The host kernel keeps no such counters */
+int32_t
+ece391_syscall_stats(int32_t which, struct ece391_syscall_stats *buf)
+{
+    return -1;
+}
+
+/* Nor does it expose its page cache */
+int32_t
+ece391_cache_stats(struct ece391_cache_stats *buf)
+{
+    return -1;
+}
+
+/* The host bits differ, so convert both ways */
+int32_t
+ece391_poll(struct ece391_pollfd *fds, int32_t nfds, int32_t timeout)
+{
+    struct pollfd host[16];
+    int32_t i, ret;
+
+    if (0 >= nfds || 16 < nfds)
+        return -1;
+    for (i = 0; i < nfds; i++)
+    {
+        host[i].fd = fds[i].fd;
+        host[i].events = ((fds[i].events & ECE391_POLLIN) ? POLLIN : 0) |
+                         ((fds[i].events & ECE391_POLLOUT) ? POLLOUT : 0);
+    }
+    ret = poll(host, nfds, timeout);
+    if (-1 == ret)
+        return -1;
+    for (i = 0; i < nfds; i++)
+        fds[i].revents = ((host[i].revents & POLLIN) ? ECE391_POLLIN : 0) |
+                         ((host[i].revents & POLLOUT) ? ECE391_POLLOUT : 0) |
+                         ((host[i].revents & POLLNVAL) ? ECE391_POLLNVAL : 0);
+    return ret;
+}
+
+int32_t
+ece391_fcntl(int32_t fd, int32_t cmd, int32_t arg)
+{
+    int flags = fcntl(fd, F_GETFL);
+
+    if (-1 == flags)
+        return -1;
+    if (ECE391_F_GETFL == cmd)
+        return (flags & O_NONBLOCK) ? ECE391_O_NONBLOCK : 0;
+    if (ECE391_F_SETFL != cmd || 0 != (arg & ~ECE391_O_NONBLOCK))
+        return -1;
+    flags = (arg & ECE391_O_NONBLOCK) ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    return (-1 == fcntl(fd, F_SETFL, flags)) ? -1 : 0;
+}
+
+int32_t
+ece391_time(uint32_t *seconds)
+{
+    *seconds = time(NULL);
+    return 0;
+}
+
+int32_t
+ece391_ring_enter(struct ece391_ring *ring, int32_t to_submit)
+{
+    struct ece391_ring_sqe *sqe;
+    struct ece391_ring_cqe *cqe;
+    uint32_t sq_tail = ring->sq_tail;
+    int32_t done = 0;
+
+    if (ECE391_RING_ENTRIES < sq_tail - ring->sq_head ||
+        ECE391_RING_ENTRIES < ring->cq_tail - ring->cq_head)
+        return -1;
+    while (ring->sq_head != sq_tail && (0 >= to_submit || done < to_submit) &&
+           ECE391_RING_ENTRIES > ring->cq_tail - ring->cq_head)
+    {
+        sqe = &ring->sq[ring->sq_head++ % ECE391_RING_ENTRIES];
+        cqe = &ring->cq[ring->cq_tail % ECE391_RING_ENTRIES];
+        cqe->user_data = sqe->user_data;
+        switch (sqe->opcode)
+        {
+        case ECE391_RING_READ:
+            cqe->result = ece391_read(sqe->fd, sqe->buf, sqe->nbytes);
+            break;
+        case ECE391_RING_WRITE:
+            cqe->result = ece391_write(sqe->fd, sqe->buf, sqe->nbytes);
+            break;
+        case ECE391_RING_OPEN:
+            cqe->result = ece391_open(sqe->buf);
+            break;
+        case ECE391_RING_CLOSE:
+            cqe->result = ece391_close(sqe->fd);
+            break;
+        default:
+            cqe->result = -1;
+        }
+        ring->cq_tail++;
+        done++;
+    }
+    return done;
+}
@@ -9,10 +9,12 @@
 int32_t
 do_one_file(const char *s, const char *fname)
 {
-	int32_t fd, cnt, last, line_start, line_end, check, s_len;
+	int32_t fd, cnt, last, line_start, line_end, check, s_len, f_len;
 	uint8_t data[BUFSIZE + 1];
+	struct ece391_iovec match[4];
 
 	s_len = ece391_strlen((uint8_t *)s);
+	f_len = ece391_strlen((uint8_t *)fname);
 	if (-1 == (fd = ece391_open((uint8_t *)fname)))
 	{
 		ece391_fdputs(1, (uint8_t *)"file open failed\n");
@@ -49,10 +51,16 @@ do_one_file(const char *s, const char *fname)
 				if (s[0] == data[check] &&
 					0 == ece391_strncmp((uint8_t *)(data + check), (uint8_t *)s, s_len))
 				{
-					ece391_fdputs(1, (uint8_t *)fname);
-					ece391_fdputs(1, (uint8_t *)":");
-					ece391_fdputs(1, data + line_start);
-					ece391_fdputs(1, (uint8_t *)"\n");
+					/* "name:line\n" in one call */
+					match[0].base = (void *)fname;
+					match[0].length = f_len;
+					match[1].base = ":";
+					match[1].length = 1;
+					match[2].base = data + line_start;
+					match[2].length = ece391_strlen(data + line_start);
+					match[3].base = "\n";
+					match[3].length = 1;
+					(void)ece391_writev(1, match, 4);
 					break;
 				}
 			}
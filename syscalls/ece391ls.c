@@ -3,29 +3,74 @@
 #include "ece391support.h"
 #include "ece391syscall.h"
 
-#define SBUFSIZE 33
+#define SBUFSIZE 128
+#define DBUFSIZE 1024
+#define NUMWIDTH 8
+
+/* Writes a number right aligned in a field of NUMWIDTH characters */
+static void put_number(uint32_t value)
+{
+    uint8_t num[12];
+    uint32_t len;
+
+    ece391_itoa(value, num, 10);
+    for (len = ece391_strlen(num); len < NUMWIDTH; len++)
+        ece391_fdputs(1, (uint8_t *)" ");
+    ece391_fdputs(1, num);
+    ece391_fdputs(1, (uint8_t *)" ");
+}
 
 int main()
 {
-    int32_t fd, cnt;
-    uint8_t buf[SBUFSIZE];
+    int32_t fd, cnt, pos;
+    int32_t long_format = 0;
+    uint8_t args[SBUFSIZE];
+    uint8_t *dir = (uint8_t *)".";
+    uint32_t buf[DBUFSIZE / sizeof(uint32_t)]; /* records are 4 byte aligned */
+    struct ece391_dirent *de;
+
+    /* ls [-l] [directory] */
+    if (0 == ece391_getargs(args, SBUFSIZE - 1))
+    {
+        args[SBUFSIZE - 1] = '\0';
+        dir = args;
+        if (0 == ece391_strncmp(args, (uint8_t *)"-l", 2) && (args[2] == ' ' || args[2] == '\0'))
+        {
+            long_format = 1;
+            dir = args + 2;
+            while (*dir == ' ')
+                dir++;
+        }
+        if (*dir == '\0')
+            dir = (uint8_t *)".";
+    }
 
-    if (-1 == (fd = ece391_open((uint8_t *)".")))
+    if (-1 == (fd = ece391_open(dir)))
     {
         ece391_fdputs(1, (uint8_t *)"directory open failed\n");
         return 2;
     }
 
-    while (0 != (cnt = ece391_read(fd, buf, SBUFSIZE - 1)))
+    /* Each call returns a whole batch of entries */
+    while (0 != (cnt = ece391_getdents(fd, buf, DBUFSIZE)))
     {
         if (-1 == cnt)
         {
             ece391_fdputs(1, (uint8_t *)"directory entry read failed\n");
             return 3;
         }
-        buf[cnt] = '\n';
-        if (-1 == ece391_write(1, buf, cnt + 1))
-            return 3;
+        for (pos = 0; pos < cnt; pos += de->reclen)
+        {
+            de = (struct ece391_dirent *)((uint8_t *)buf + pos);
+            if (long_format)
+            {
+                ece391_fdputs(1, (uint8_t *)(de->type == 1 ? "d" : de->type == 0 ? "c" : "-"));
+                put_number(de->inode);
+                put_number(de->length);
+            }
+            ece391_fdputs(1, de->name);
+            ece391_fdputs(1, (uint8_t *)"\n");
+        }
     }
 
     return 0;
@@ -12,6 +12,33 @@
 #define STARTCHAR 'A'
 #define ENDCHAR 'Z'
 
+/* Waits for the next RTC tick; returns 1 instead if Enter was pressed */
+static int32_t wait_tick(int32_t rtc_fd)
+{
+	struct ece391_pollfd fds[2];
+	uint8_t line[BUFMAX];
+	int32_t garbage;
+
+	fds[0].fd = rtc_fd;
+	fds[0].events = ECE391_POLLIN;
+	fds[1].fd = 0;
+	fds[1].events = ECE391_POLLIN;
+	if (-1 == ece391_poll(fds, 2, -1))
+	{
+		// Fall back to blocking on the RTC alone
+		ece391_read(rtc_fd, &garbage, 4);
+		return 0;
+	}
+	if (fds[1].revents & ECE391_POLLIN)
+	{
+		ece391_read(0, line, BUFMAX);
+		return 1;
+	}
+	if (fds[0].revents & ECE391_POLLIN)
+		ece391_read(rtc_fd, &garbage, 4);
+	return 0;
+}
+
 int main()
 {
 	int32_t i = 0;
@@ -19,7 +46,6 @@ int main()
 	uint8_t curchar = STARTCHAR;
 	uint8_t update = 1;
 	int ret_val;
-	int garbage;
 	int rtc_fd;
 	uint8_t buf[BUFMAX];
 
@@ -53,8 +79,9 @@ int main()
 			buf[j] = curchar;
 			ece391_fdputs(1, buf);
 
-			// Wait for RTC tick
-			ece391_read(rtc_fd, &garbage, 4);
+			// Wait for RTC tick, quit on Enter
+			if (wait_tick(rtc_fd))
+				return 0;
 		}
 
 		// Bounce back
@@ -70,8 +97,9 @@ int main()
 			buf[j] = curchar;
 			ece391_fdputs(1, buf);
 
-			// Wait for RTC tick
-			ece391_read(rtc_fd, &garbage, 4);
+			// Wait for RTC tick, quit on Enter
+			if (wait_tick(rtc_fd))
+				return 0;
 		}
 
 		// Edge case on characters
@@ -0,0 +1,85 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define CALLS 10000
+
+/* Reads the time stamp counter */
+static uint64_t rdtsc(void)
+{
+    uint64_t val;
+    asm volatile("rdtsc" : "=A"(val));
+    return val;
+}
+
+/*
+ * Average cycles for a system call that does no work: close(-1) fails
+ * as soon as it is dispatched, so this is the cost of getting into the
+ * kernel and back.
+ */
+static uint32_t cycles_per_call(void)
+{
+    uint64_t start;
+    int32_t i;
+
+    start = rdtsc();
+    for (i = 0; i < CALLS; i++)
+        (void)ece391_close(-1);
+    return (uint32_t)(rdtsc() - start) / CALLS;
+}
+
+/* Average cycles per close(-1) when a full ring of them goes in with one ring_enter */
+static uint32_t cycles_per_ring_request(void)
+{
+    static struct ece391_ring ring;
+    uint64_t start;
+    int32_t i, j;
+
+    start = rdtsc();
+    for (i = 0; i < CALLS / ECE391_RING_ENTRIES; i++)
+    {
+        for (j = 0; j < ECE391_RING_ENTRIES; j++)
+        {
+            ring.sq[ring.sq_tail % ECE391_RING_ENTRIES].opcode = ECE391_RING_CLOSE;
+            ring.sq[ring.sq_tail % ECE391_RING_ENTRIES].fd = -1;
+            ring.sq_tail++;
+        }
+        (void)ece391_ring_enter(&ring, 0);
+        ring.cq_head = ring.cq_tail;
+    }
+    return (uint32_t)(rdtsc() - start) / (CALLS / ECE391_RING_ENTRIES * ECE391_RING_ENTRIES);
+}
+
+static void put_result(const char *label, uint32_t cycles)
+{
+    uint8_t num[12];
+
+    ece391_fdputs(1, (uint8_t *)label);
+    ece391_itoa(cycles, num, 10);
+    ece391_fdputs(1, num);
+    ece391_fdputs(1, (uint8_t *)" cycles per call\n");
+}
+
+int main()
+{
+    int32_t fast = ece391_fast_syscall;
+    uint32_t trap, sysenter;
+
+    ece391_fast_syscall = 0;
+    trap = cycles_per_call();
+    put_result("int $0x80: ", trap);
+    put_result("ring:      ", cycles_per_ring_request());
+    ece391_fast_syscall = fast;
+    if (!fast)
+    {
+        ece391_fdputs(1, (uint8_t *)"no SYSENTER on this CPU\n");
+        return 0;
+    }
+    ece391_fast_syscall = 1;
+    sysenter = cycles_per_call();
+    put_result("sysenter:  ", sysenter);
+    if (sysenter < trap)
+        put_result("saved:     ", trap - sysenter);
+    return 0;
+}
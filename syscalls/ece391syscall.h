@@ -5,6 +5,13 @@
 
 /* All calls return >= 0 on success or -1 on failure. */
 
+/*
+ * Calls enter the kernel with SYSENTER when the CPU has it (this is set
+ * before main runs) and with int $0x80 otherwise.  Clearing it forces
+ * int $0x80, which still works everywhere.
+ */
+extern int32_t ece391_fast_syscall;
+
 /*
  * Note that the system call for halt will have to make sure that only
  * the low byte of EBX (the status argument) is returned to the calling
@@ -22,6 +29,196 @@ extern int32_t ece391_vidmap(uint8_t **screen_start);
 extern int32_t ece391_set_handler(int32_t signum, void *handler);
 extern int32_t ece391_sigreturn(void);
 
+/*
+ * Fills buf with as many directory records as fit and returns the number
+ * of bytes used (0 once the directory is exhausted).  Records are packed
+ * back to back; step from one to the next with reclen.
+ */
+extern int32_t ece391_getdents(int32_t fd, void *buf, int32_t nbytes);
+
+struct ece391_dirent
+{
+	uint32_t inode;
+	uint32_t type;	 /* 0 RTC, 1 directory, 2 regular file */
+	uint32_t length; /* size in bytes */
+	uint16_t reclen;
+	uint16_t namelen;
+	uint8_t name[]; /* NUL terminated */
+};
+
+/*
+ * Fill in buf with the inode, type and length of a file, by name or by
+ * open descriptor, so a buffer can be sized before reading.  fstat fails
+ * on stdin and stdout.
+ */
+struct ece391_stat
+{
+	uint32_t inode;
+	uint32_t type;	 /* 0 RTC, 1 directory, 2 regular file */
+	uint32_t length; /* size in bytes */
+	uint32_t blocks; /* 4kB data blocks */
+};
+
+extern int32_t ece391_stat(const uint8_t *filename, struct ece391_stat *buf);
+extern int32_t ece391_fstat(int32_t fd, struct ece391_stat *buf);
+
+/*
+ * lseek moves the position the next read of fd starts from and returns
+ * it; for a directory the position counts entries.  pread reads nbytes
+ * at offset without using or moving that position.
+ */
+#define ECE391_SEEK_SET 0
+#define ECE391_SEEK_CUR 1
+#define ECE391_SEEK_END 2
+
+extern int32_t ece391_lseek(int32_t fd, int32_t offset, int32_t whence);
+extern int32_t ece391_pread(int32_t fd, void *buf, int32_t nbytes, int32_t offset);
+
+/*
+ * dup makes the lowest free descriptor refer to the same open file as fd;
+ * dup2 makes new_fd refer to it, closing new_fd first.  Both descriptors
+ * share one position.  A child starts with its parent's descriptors 0
+ * and 1, so dup2(fd, 0) before execute makes fd the child's input.
+ */
+extern int32_t ece391_dup(int32_t fd);
+extern int32_t ece391_dup2(int32_t fd, int32_t new_fd);
+
+/*
+ * readv and writev move up to ECE391_IOV_MAX buffers in one call, in
+ * order, and return the total moved.  They stop early at the first
+ * buffer that is not filled (or not fully written).
+ */
+#define ECE391_IOV_MAX 16
+
+struct ece391_iovec
+{
+	void *base;
+	uint32_t length;
+};
+
+extern int32_t ece391_readv(int32_t fd, const struct ece391_iovec *iov, int32_t iovcnt);
+extern int32_t ece391_writev(int32_t fd, const struct ece391_iovec *iov, int32_t iovcnt);
+
+/*
+ * A submission/completion ring lives in the program's own memory.  To
+ * post a request, fill sq[sq_tail % ECE391_RING_ENTRIES] and then bump
+ * sq_tail.  ring_enter runs up to to_submit posted requests in order
+ * (all of them if to_submit <= 0) and returns how many it ran.  It
+ * posts a completion for each one at cq_tail.  Consume completions up
+ * to cq_tail and then bump cq_head.  ring_enter stops early when the
+ * completion ring is full.
+ */
+#define ECE391_RING_ENTRIES 32
+#define ECE391_RING_READ 0
+#define ECE391_RING_WRITE 1
+#define ECE391_RING_OPEN 2 /* buf is the file name */
+#define ECE391_RING_CLOSE 3
+
+struct ece391_ring_sqe
+{
+	uint32_t opcode;
+	int32_t fd;
+	void *buf;
+	int32_t nbytes;
+	uint32_t user_data;
+};
+
+struct ece391_ring_cqe
+{
+	uint32_t user_data;
+	int32_t result;
+};
+
+struct ece391_ring
+{
+	volatile uint32_t sq_head; /* kernel */
+	volatile uint32_t sq_tail; /* program */
+	volatile uint32_t cq_head; /* program */
+	volatile uint32_t cq_tail; /* kernel */
+	struct ece391_ring_sqe sq[ECE391_RING_ENTRIES];
+	struct ece391_ring_cqe cq[ECE391_RING_ENTRIES];
+};
+
+extern int32_t ece391_ring_enter(struct ece391_ring *ring, int32_t to_submit);
+
+/*
+ * syscall_stats copies out, for every system call number, how many
+ * calls were made, their total cycles and a histogram.  Bucket i of the
+ * histogram counts calls that took 2^i to 2^(i+1) cycles.  Cycles run
+ * from entry to return, so a call that blocks includes its wait.  which
+ * picks the calling process or every process since boot.
+ */
+#define ECE391_NUM_SYSCALLS 26
+#define ECE391_HISTOGRAM_BUCKETS 32
+#define ECE391_STATS_SELF 0
+#define ECE391_STATS_ALL 1
+
+struct ece391_syscall_counter
+{
+	uint32_t calls;
+	uint64_t cycles;
+	uint32_t histogram[ECE391_HISTOGRAM_BUCKETS];
+};
+
+struct ece391_syscall_stats
+{
+	struct ece391_syscall_counter syscalls[ECE391_NUM_SYSCALLS];
+};
+
+extern int32_t ece391_syscall_stats(int32_t which, struct ece391_syscall_stats *buf);
+
+/*
+ * poll waits until one of up to 16 descriptors is ready for the events
+ * asked for, then returns how many have revents set.  timeout is in
+ * milliseconds: 0 only checks, less than 0 waits for as long as it takes.
+ * A closed descriptor reports ECE391_POLLNVAL.
+ */
+#define ECE391_POLLIN 0x01
+#define ECE391_POLLOUT 0x04
+#define ECE391_POLLNVAL 0x20
+
+struct ece391_pollfd
+{
+	int32_t fd;
+	uint16_t events;
+	uint16_t revents;
+};
+
+extern int32_t ece391_poll(struct ece391_pollfd *fds, int32_t nfds, int32_t timeout);
+
+/*
+ * fcntl gets (F_GETFL) or replaces (F_SETFL) an open file's flags.  With
+ * ECE391_O_NONBLOCK set, a read or readv of the terminal or RTC that would
+ * wait returns ECE391_WOULD_BLOCK at once instead.  Dups share the flags.
+ */
+#define ECE391_O_NONBLOCK 0x2
+#define ECE391_F_GETFL 3
+#define ECE391_F_SETFL 4
+#define ECE391_WOULD_BLOCK -2
+
+extern int32_t ece391_fcntl(int32_t fd, int32_t cmd, int32_t arg);
+
+/*
+ * time stores the seconds since 1970-01-01 00:00 UTC.  The kernel reads
+ * the CMOS clock once at boot and counts timer ticks from there.
+ */
+extern int32_t ece391_time(uint32_t *seconds);
+
+/*
+ * cache_stats copies out how the page cache for disk-backed files has
+ * done since boot: lookups it answered, lookups that went to the disk,
+ * pages read ahead for sequential readers and pages it evicted.
+ */
+struct ece391_cache_stats
+{
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t readaheads;
+	uint32_t evictions;
+};
+
+extern int32_t ece391_cache_stats(struct ece391_cache_stats *buf);
+
 enum signums
 {
 	DIV_ZERO = 0,
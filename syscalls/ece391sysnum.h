@@ -11,5 +11,20 @@
 #define SYS_VIDMAP 8
 #define SYS_SET_HANDLER 9
 #define SYS_SIGRETURN 10
+#define SYS_GETDENTS 11
+#define SYS_STAT 12
+#define SYS_FSTAT 13
+#define SYS_LSEEK 14
+#define SYS_PREAD 15
+#define SYS_DUP 16
+#define SYS_DUP2 17
+#define SYS_READV 18
+#define SYS_WRITEV 19
+#define SYS_RING_ENTER 20
+#define SYS_SYSCALL_STATS 21
+#define SYS_POLL 22
+#define SYS_FCNTL 23
+#define SYS_TIME 24
+#define SYS_CACHE_STATS 25
 
 #endif /* ECE391SYSNUM_H */
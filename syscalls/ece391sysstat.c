@@ -0,0 +1,111 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define SBUFSIZE 128
+#define NUMWIDTH 10
+
+static const char *names[ECE391_NUM_SYSCALLS] = {
+    "", "halt", "execute", "read", "write", "open", "close", "getargs",
+    "vidmap", "set_handler", "sigreturn", "getdents", "stat", "fstat",
+    "lseek", "pread", "dup", "dup2", "readv", "writev", "ring_enter",
+    "syscall_stats", "poll", "fcntl", "time", "cache_stats"};
+
+/* Writes a number right aligned in a field of NUMWIDTH characters */
+static void put_number(uint32_t value)
+{
+    uint8_t num[12];
+    uint32_t len;
+
+    ece391_itoa(value, num, 10);
+    for (len = ece391_strlen(num); len < NUMWIDTH; len++)
+        ece391_fdputs(1, (uint8_t *)" ");
+    ece391_fdputs(1, num);
+}
+
+/* Writes a name left aligned in a field of 14 characters */
+static void put_name(const char *name)
+{
+    uint32_t len;
+
+    ece391_fdputs(1, (uint8_t *)name);
+    for (len = ece391_strlen((uint8_t *)name); len < 14; len++)
+        ece391_fdputs(1, (uint8_t *)" ");
+}
+
+/* Prints the page cache counters and the share of lookups that hit */
+static int32_t put_cache_stats(void)
+{
+    struct ece391_cache_stats cache;
+    uint32_t lookups;
+
+    if (-1 == ece391_cache_stats(&cache))
+    {
+        ece391_fdputs(1, (uint8_t *)"cache_stats failed\n");
+        return 2;
+    }
+    lookups = cache.hits + cache.misses;
+    put_name("hits");
+    put_number(cache.hits);
+    ece391_fdputs(1, (uint8_t *)"\n");
+    put_name("misses");
+    put_number(cache.misses);
+    ece391_fdputs(1, (uint8_t *)"\n");
+    put_name("readaheads");
+    put_number(cache.readaheads);
+    ece391_fdputs(1, (uint8_t *)"\n");
+    put_name("evictions");
+    put_number(cache.evictions);
+    ece391_fdputs(1, (uint8_t *)"\n");
+    put_name("hit rate %");
+    put_number(lookups == 0 ? 0 : cache.hits * 100 / lookups);
+    ece391_fdputs(1, (uint8_t *)"\n");
+    return 0;
+}
+
+/*
+ * sysstat [-a | -c]: calls, kilocycles and the most common latency bucket
+ * of each system call this program (or, with -a, everything since boot)
+ * made; with -c, the page cache counters instead
+ */
+int main()
+{
+    static struct ece391_syscall_stats stats;
+    uint8_t args[SBUFSIZE];
+    uint8_t num[12];
+    int32_t which = ECE391_STATS_SELF;
+    int32_t i, b, top;
+
+    if (0 == ece391_getargs(args, SBUFSIZE - 1))
+    {
+        if (0 == ece391_strncmp(args, (uint8_t *)"-a", 2))
+            which = ECE391_STATS_ALL;
+        else if (0 == ece391_strncmp(args, (uint8_t *)"-c", 2))
+            return put_cache_stats();
+    }
+    if (-1 == ece391_syscall_stats(which, &stats))
+    {
+        ece391_fdputs(1, (uint8_t *)"syscall_stats failed\n");
+        return 2;
+    }
+
+    put_name("syscall");
+    ece391_fdputs(1, (uint8_t *)"     calls   kcycles   typical\n");
+    for (i = 1; i < ECE391_NUM_SYSCALLS; i++)
+    {
+        if (0 == stats.syscalls[i].calls)
+            continue;
+        top = 0;
+        for (b = 1; b < ECE391_HISTOGRAM_BUCKETS; b++)
+            if (stats.syscalls[i].histogram[b] > stats.syscalls[i].histogram[top])
+                top = b;
+        put_name(names[i]);
+        put_number(stats.syscalls[i].calls);
+        put_number((uint32_t)(stats.syscalls[i].cycles >> 10));
+        ece391_fdputs(1, (uint8_t *)"      2^");
+        ece391_fdputs(1, ece391_itoa(top, num, 10));
+        ece391_fdputs(1, (uint8_t *)"\n");
+    }
+    return 0;
+}